@@ -0,0 +1,123 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file benchB4a.cc
+/// \brief Replay of the step streams and micro-benchmark of the user actions of B4a
+
+#include "B4DetectorConstruction.hh"
+#include "B4RunAction.hh"
+#include "B4aEventAction.hh"
+#include "B4aSteppingAction.hh"
+#include "B4StepReplay.hh"
+
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4UIcommand.hh"
+
+#include <vector>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace {
+  void PrintUsage() {
+    G4cerr << " Usage: " << G4endl;
+    G4cerr << " benchB4a [-m macro] [-n nRepetitions] stream.b4s [...]"
+           << G4endl;
+    G4cerr << "   note: the streams are recorded with /B4/stream/capture"
+           << " (see stream.mac)." << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc,char** argv)
+{
+  // Evaluate arguments
+  //
+  G4String macro;
+  G4int nRepetitions = 10;
+  std::vector<G4String> streamNames;
+  for ( G4int i=1; i<argc; ++i ) {
+    if      ( G4String(argv[i]) == "-m" && i+1 < argc ) macro = argv[++i];
+    else if ( G4String(argv[i]) == "-n" && i+1 < argc ) {
+      nRepetitions = G4UIcommand::ConvertToInt(argv[++i]);
+    }
+    else if ( argv[i][0] != '-' ) streamNames.push_back(argv[i]);
+    else {
+      PrintUsage();
+      return 1;
+    }
+  }
+  if ( streamNames.empty() ) {
+    PrintUsage();
+    return 1;
+  }
+
+  // The user actions of a sequential run without physics: the detector is
+  // constructed for the volumes and the tile and layer sizes only, and the
+  // run manager is not initialized
+  //
+  auto runManager = new G4RunManager;
+  auto detConstruction = new B4DetectorConstruction();
+  detConstruction->Construct();
+  auto runAction = new B4RunAction(detConstruction);
+  auto eventAction = new B4aEventAction(detConstruction, runAction);
+  auto steppingAction
+    = new B4aSteppingAction(detConstruction, eventAction,
+                            runAction->GetStepProfiler(),
+                            runAction->GetStepStream());
+  runManager->SetPrintProgress(0);
+
+  // The output and event collection commands (/B4/output/, /B4/event/)
+  //
+  if ( macro.size() ) {
+    G4UImanager::GetUIpointer()->ApplyCommand("/control/execute " + macro);
+  }
+
+  // Read the streams in memory and replay them
+  //
+  B4StepReplay replay(runAction, eventAction, steppingAction);
+  G4int nofEvents = 0;
+  for (const auto& streamName : streamNames) {
+    nofEvents += replay.ReadStream(streamName);
+  }
+  if ( nofEvents > 0 ) {
+    replay.Replay(nRepetitions);
+    replay.PrintTimes();
+  }
+
+  // Job termination
+  //
+  delete steppingAction;
+  delete eventAction;
+  delete runAction;
+  delete detConstruction;
+  delete runManager;
+
+  return ( nofEvents > 0 ) ? 0 : 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
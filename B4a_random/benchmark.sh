@@ -0,0 +1,109 @@
+# Benchmark of fixed-seed workloads: pi- at each energy, in sequential mode
+# and with the given number of threads, for each output profile. The
+# events/s, steps/s, peak resident memory, startup time and output
+# bytes/event of each workload are written to benchmark.json (one workload
+# per line). With BASELINE=<previous benchmark.json> the events/s and
+# steps/s are compared with the previous report, and the script fails when
+# one of them dropped by more than TOLERANCE (default 0.05).
+#   ./benchmark.sh [number of events] [threads]
+# or from the build directory: make benchmark
+# (in B4a_random the energy of each event is random, ENERGIES=random)
+nevents=${1:-${NEVENTS:-200}}
+threads=${2:-${NTHREADS:-`nproc`}}
+energies=${ENERGIES:-random}
+profiles=${PROFILES:-"full cnn timing resolution"}
+seed=${SEED:-12345}
+warmup=${WARMUP:-10}
+output=${OUTPUT:-benchmark.json}
+commit=`git -C "${SOURCE_DIR:-.}" rev-parse --short HEAD 2>/dev/null`
+
+value() {
+  echo "$1" | sed -n -e "s/$2/\1/p" | tail -1
+}
+
+echo "[" > ${output}
+separator=" "
+for energy in ${energies}; do
+  for nthreads in 0 ${threads}; do
+    for profile in ${profiles}; do
+      label=${energy}
+      [ "${energy}" != random ] && label=${energy}GeV
+      name=pi_${label}_t${nthreads}_${profile}
+      dir=benchmark/${name}
+      rm -rf ${dir}
+      mkdir -p ${dir}
+
+      # the first run initializes the physics of the threads and is not
+      # measured; the events are the same in all modes (see SeedEvent())
+      {
+        echo "/run/initialize"
+        echo "/gun/particle pi-"
+        [ "${energy}" != random ] && echo "/gun/energy ${energy} GeV"
+        echo "/run/printProgress 0"
+        echo "/B4/random/setRunSeed ${seed}"
+        echo "/B4/output/profile ${profile}"
+        echo "/B4/output/directory ${dir}"
+        echo "/run/beamOn ${warmup}"
+        echo "/run/beamOn ${nevents}"
+      } > ${dir}/run.mac
+
+      if [ ${nthreads} -eq 0 ]; then
+        options="-r Serial"
+      else
+        options="-r MT -t ${nthreads}"
+      fi
+      ./exampleB4a -m ${dir}/run.mac ${options} > ${dir}/run.log 2>&1
+      log=`cat ${dir}/run.log`
+
+      startup=`value "${log}" '.*startup time \([0-9.e+-]*\) s.*'`
+      events=`value "${log}" '.* \([0-9]*\) events in [0-9.e+-]* s (.*'`
+      rate=`value "${log}" '.*(\([0-9.e+-]*\) events\/s).*'`
+      steps=`value "${log}" '.*(\([0-9.e+-]*\) steps\/s).*'`
+      rss=`value "${log}" '.*peak RSS \([0-9.e+-]*\) MB.*'`
+      bytes=`cat ${dir}/*.root 2>/dev/null | wc -c`
+      perEvent=`awk -v b=${bytes} -v n=${events:-0} 'BEGIN { if ( n > 0 ) print b/n }'`
+
+      line="{\"workload\": \"${name}\", \"particle\": \"pi-\", \"energy\": \"${energy}\", \"threads\": ${nthreads}, \"profile\": \"${profile}\", \"seed\": ${seed}, \"events\": ${events:-null}, \"eventsPerSecond\": ${rate:-null}, \"stepsPerSecond\": ${steps:-null}, \"peakRssMB\": ${rss:-null}, \"startupSeconds\": ${startup:-null}, \"bytesPerEvent\": ${perEvent:-null}, \"commit\": \"${commit}\"}"
+      echo "${separator}${line}" >> ${output}
+      separator=","
+      echo "${name}: ${rate:-failed} events/s, ${steps:--} steps/s, ${rss:--} MB, startup ${startup:--} s, ${perEvent:--} bytes/event"
+    done
+  done
+done
+echo "]" >> ${output}
+echo "report written in ${output}"
+
+# comparison with a previous report
+[ -n "${BASELINE}" ] || exit 0
+awk -v tolerance=${TOLERANCE:-0.05} '
+  function field(line, key) {
+    if ( ! match(line, "\"" key "\": [^,}]*") ) return ""
+    value = substr(line, RSTART + length(key) + 4, RLENGTH - length(key) - 4)
+    gsub(/"/, "", value)
+    return value
+  }
+  FNR == NR {
+    name = field($0, "workload")
+    if ( name != "" ) {
+      baseRate[name] = field($0, "eventsPerSecond")
+      baseSteps[name] = field($0, "stepsPerSecond")
+    }
+    next
+  }
+  {
+    name = field($0, "workload")
+    if ( name == "" || ! ( name in baseRate ) ) next
+    rate = field($0, "eventsPerSecond")
+    steps = field($0, "stepsPerSecond")
+    if ( rate == "null" || baseRate[name] == "null" || baseRate[name] == 0 ) {
+      printf "%s: not compared\n", name
+      next
+    }
+    ratio = rate / baseRate[name]
+    stepsRatio = ( steps != "null" && baseSteps[name] > 0 ) ? steps / baseSteps[name] : ratio
+    status = ( ratio < 1 - tolerance || stepsRatio < 1 - tolerance ) ? "REGRESSION" : "ok"
+    if ( status != "ok" ) ++nofRegressions
+    printf "%s: events/s x %.3f, steps/s x %.3f %s\n", name, ratio, stepsRatio, status
+  }
+  END { exit ( nofRegressions > 0 ) }
+' "${BASELINE}" ${output}
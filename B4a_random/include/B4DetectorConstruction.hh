@@ -70,6 +70,9 @@ class B4DetectorConstruction : public G4VUserDetectorConstruction
     G4double fWorldEdgeZ;
     G4double fECalorEdgeZ;
     G4double fHCalorEdgeZ;
+    G4double fHGapThickness;
+    G4double fHTileSize;
+    G4double fHLayerThickness;
      
   private:
     // methods
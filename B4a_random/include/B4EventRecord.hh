@@ -0,0 +1,115 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4EventRecord.hh
+/// \brief Definition of the B4EventRecord class
+
+#ifndef B4EventRecord_h
+#define B4EventRecord_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+/// Ntuple rows of one event.
+///
+/// The rows of each ntuple are stored flat, column after column, and are
+/// written to the analysis manager in one go by B4RunAction::WriteEventRecord(),
+/// either directly at the end of event or later by B4EventReorderBuffer.
+
+class B4EventRecord
+{
+  public:
+    B4EventRecord();
+    ~B4EventRecord();
+
+    void Reset(G4int eventID, G4int nofNtuples);
+    template <typename... Values>
+    void AddRow(G4int ntupleId, Values... values);
+    void AppendToRow(G4int ntupleId, const G4double* values, std::size_t nofValues);
+
+    G4int GetEventID() const;
+    G4int GetNofNtuples() const;
+    const std::vector<G4double>& GetRows(G4int ntupleId) const;
+    std::size_t GetNofBytes() const;
+
+  private:
+    G4int fEventID;
+    std::vector<std::vector<G4double>> fRows;//[ntupleId][row*nofColumns+column]
+};
+
+// inline functions
+
+inline B4EventRecord::B4EventRecord()
+ : fEventID(-1)
+{}
+
+inline B4EventRecord::~B4EventRecord()
+{}
+
+inline void B4EventRecord::Reset(G4int eventID, G4int nofNtuples) {
+  // the capacity of the row buffers is kept for the next event (in the
+  // reorder mode the record is swapped with one already written)
+  fEventID = eventID;
+  fRows.resize(nofNtuples);
+  for (auto& rows : fRows) rows.clear();
+}
+
+template <typename... Values>
+inline void B4EventRecord::AddRow(G4int ntupleId, Values... values) {
+  const G4double row[] = { static_cast<G4double>(values)... };
+  auto& rows = fRows[ntupleId];
+  rows.insert(rows.end(), row, row + sizeof...(values));
+}
+
+inline void B4EventRecord::AppendToRow(G4int ntupleId, const G4double* values,
+                                       std::size_t nofValues) {
+  // the values continue the last row added with AddRow()
+  auto& rows = fRows[ntupleId];
+  rows.insert(rows.end(), values, values + nofValues);
+}
+
+inline G4int B4EventRecord::GetEventID() const {
+  return fEventID;
+}
+
+inline G4int B4EventRecord::GetNofNtuples() const {
+  return fRows.size();
+}
+
+inline const std::vector<G4double>& B4EventRecord::GetRows(G4int ntupleId) const {
+  return fRows[ntupleId];
+}
+
+inline std::size_t B4EventRecord::GetNofBytes() const {
+  std::size_t nofBytes = sizeof(B4EventRecord);
+  for (const auto& rows : fRows) nofBytes += rows.capacity()*sizeof(G4double);
+  return nofBytes;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
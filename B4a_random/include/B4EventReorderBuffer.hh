@@ -0,0 +1,109 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4EventReorderBuffer.hh
+/// \brief Definition of the B4EventReorderBuffer class
+
+#ifndef B4EventReorderBuffer_h
+#define B4EventReorderBuffer_h 1
+
+#include "globals.hh"
+#include "B4EventRecord.hh"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Reorder stage for the ntuple output.
+///
+/// The worker threads only enqueue the rows of each finished event with
+/// Submit(). The events are passed to the writer function strictly in the
+/// event ID order by a dedicated writer thread, started by Start() and
+/// joined by Flush(), so that the writer function (which fills the ntuples
+/// of the master's analysis manager) is never called by the workers nor
+/// concurrently with the master. At most fWindow events wait in the buffer;
+/// a thread submitting an event beyond the window waits until the missing
+/// events are written (or until the stall timeout expires, then the window
+/// is exceeded).
+/// An event submitted after the window was exceeded beyond it is written
+/// as soon as it arrives, out of order, and counted as an order violation.
+/// The written records are kept in a pool and swapped into the records
+/// submitted by the workers, so that the capacity of their row buffers is
+/// reused by the next events.
+/// The memory used by the waiting events, the stall time and the order
+/// violations are reported by PrintStatistics().
+
+class B4EventReorderBuffer
+{
+  public:
+    using Writer = std::function<void(const B4EventRecord&)>;
+
+    B4EventReorderBuffer();
+    ~B4EventReorderBuffer();
+
+    void Start(G4int window, Writer writer);
+    void Submit(B4EventRecord& record);
+    void Flush();
+    void PrintStatistics() const;
+
+    std::mutex& GetMutex();
+
+  private:
+    void WriteEvents();
+
+    std::mutex fMutex;
+    std::condition_variable fCondition;//[window waiters]
+    std::condition_variable fReadyCondition;//[writer thread]
+    std::thread fWriterThread;
+    G4bool fStopping;
+    std::map<G4int, B4EventRecord> fPending;
+    std::vector<B4EventRecord> fFreeRecords;
+    Writer fWriter;
+    G4int fWindow;
+    G4int fNextEventID;
+
+    // statistics
+    std::size_t fPendingBytes;
+    std::size_t fPeakPendingBytes;
+    std::size_t fPeakPendingEvents;
+    G4int fNofStalls;
+    G4int fNofOverflows;
+    G4int fNofViolations;
+    G4double fStallTime;
+};
+
+// inline functions
+
+inline std::mutex& B4EventReorderBuffer::GetMutex() {
+  return fMutex;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,125 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4MemoryMonitor.hh
+/// \brief Definition of the B4MemoryMonitor class
+
+#ifndef B4MemoryMonitor_h
+#define B4MemoryMonitor_h 1
+
+#include "globals.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class G4GenericMessenger;
+
+/// Memory instrumentation of the threads.
+///
+/// The global operator new and delete of the program (including the
+/// over-aligned forms) are replaced by counting hooks (B4MemoryMonitor.cc); with /B4/memory/monitor true they
+/// count, for the thread which calls them, the allocations and the
+/// allocated bytes, and the heap bytes allocated and not yet freed since
+/// the start of run, whose maximum is the peak heap of the thread (the
+/// resident memory is only known for the whole process). When the monitor
+/// is off, the hooks only test a flag.
+///
+/// B4aEventAction calls BeginEvent() and EndEvent(), which give the
+/// allocations and bytes of each event, and passes the capacity in bytes
+/// of its per-event buffers to SetBufferBytes(), which keeps their
+/// high-water mark. At the end of run the summary of each thread is
+/// merged by Merge(), and the master prints it with the peak and current
+/// resident memory of the process and writes it in a .memory table next
+/// to the output file with Write().
+
+class B4MemoryMonitor
+{
+  public:
+    // the per-event buffers of B4aEventAction
+    enum EBuffer {
+      kGapEdepHits = 0,
+      kHitIndex,
+      kIncidents,
+      kFiredTiles,
+      kDigitization,
+      kTimeWindow,
+      kEventRecord,
+      kNofBuffers
+    };
+
+    B4MemoryMonitor();
+    ~B4MemoryMonitor();
+
+    G4bool IsEnabled() const;
+
+    void BeginOfRun();
+    void BeginEvent();
+    void SetBufferBytes(EBuffer buffer, std::size_t nofBytes);
+    void EndEvent();
+
+    void Merge();
+    void Write(const G4String& fileName) const;
+
+  private:
+    void DefineCommands();
+
+    struct ThreadMemory {
+      G4int fThreadId;
+      G4int fNofEvents;
+      G4double fAllocations;
+      G4double fMaxAllocations;
+      G4double fBytes;
+      G4double fMaxBytes;
+      G4double fPeakHeap;
+      G4double fBuffers[kNofBuffers];
+    };
+
+    static std::vector<ThreadMemory> fgThreads;
+    static std::mutex fgMutex;
+
+    G4GenericMessenger* fMessenger;
+    G4bool fEnabled;
+    ThreadMemory fThread;
+    std::uint64_t fEventAllocations;
+    std::uint64_t fEventBytes;
+};
+
+// inline functions
+
+inline G4bool B4MemoryMonitor::IsEnabled() const {
+  return fEnabled;
+}
+
+inline void B4MemoryMonitor::SetBufferBytes(EBuffer buffer,
+                                            std::size_t nofBytes) {
+  if ( nofBytes > fThread.fBuffers[buffer] ) fThread.fBuffers[buffer] = nofBytes;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -32,10 +32,25 @@
 
 #include "G4UserRunAction.hh"
 #include "globals.hh"
+#include "G4SystemOfUnits.hh"
 
 #include "B4DetectorConstruction.hh"
+#include "B4Analysis.hh"
+#include "B4JobSplitter.hh"
+
+#include <mutex>
+#include <vector>
 
 class G4Run;
+class G4GenericMessenger;
+class B4EventRecord;
+class B4EventReorderBuffer;
+class B4SiPMDigitizer;
+class B4StepProfiler;
+class B4StepStreamWriter;
+class B4MemoryMonitor;
+class B4RunTimer;
+class B4ShardOutput;
 
 /// Run action class
 ///
@@ -54,6 +69,25 @@ class G4Run;
 /// In EndOfRunAction(), the accumulated statistic and computed 
 /// dispersion is printed.
 ///
+/// The ntuple rows of each event are passed as a B4EventRecord to
+/// FillEvent(); the trees and their columns are selected with
+/// /B4/output/profile (full, cnn, timing, resolution) when they are booked
+/// in the first run, and /B4/histo/shape true adds the shower shape
+/// histograms. With /B4/output/reorder true the rows are written in the
+/// event order by a B4EventReorderBuffer, with /B4/output/shards true each
+/// worker writes its own file. The output file is written under a
+/// temporary name and renamed at the end of run after the template of
+/// /B4/output/fileName (%e energy, %s seed, %r run, %j shard, %t thread).
+///
+/// The random engine is re-seeded for each event from the run seed, the
+/// run ID and the event number (SeedEvent()), so that an event can be
+/// replayed alone with /B4/random/replayEvent and replayRun.
+///
+/// The helpers of each thread are owned by the run action: B4SiPMDigitizer,
+/// B4StepProfiler, B4StepStreamWriter, B4MemoryMonitor, B4RunTimer,
+/// B4ShardOutput and B4JobSplitter. With B4_USE_MPI the histograms of all
+/// ranks are merged to rank 0 at the end of run.
+///
 
 class B4RunAction : public G4UserRunAction
 {
@@ -64,10 +98,179 @@ class B4RunAction : public G4UserRunAction
     virtual void BeginOfRunAction(const G4Run*);
     virtual void   EndOfRunAction(const G4Run*);
 
+    G4int GetEventNumber(G4int eventID) const;
+    G4int GetRunSeed() const;
+    G4int GetRunID() const;
+    const G4String& GetOutputFileName() const;
+    void SeedEvent(G4int eventID) const;
+
+    // ntuples in the order of the B4EventRecord rows
+    enum ENtuple {
+      kEventNtuple = 0,
+      kEdepNtuple,
+      kGapEdepNtuple,
+      kConditionNtuple,
+      kDigiNtuple,
+      kShowerNtuple,
+      kNofNtuples
+    };
+
+    G4int GetNofNtuples() const;
+    G4bool IsNtupleActive(G4int ntuple) const;
+    const B4SiPMDigitizer* GetDigitizer() const;
+    B4StepProfiler* GetStepProfiler() const;
+    B4StepStreamWriter* GetStepStream() const;
+    B4MemoryMonitor* GetMemoryMonitor() const;
+    B4RunTimer* GetRunTimer() const;
+
+    // shower shape histograms
+    G4bool IsShapeActive() const;
+    G4int GetNofRadiusBins() const;
+    G4double GetRadiusMax() const;
+    G4int GetNofTimeBins() const;
+    G4double GetTimeMax() const;
+    void FillEvent(B4EventRecord& record) const;
+
   private:
+    void DefineCommands();
+    void Book();
+    void BookNtuple(G4int ntuple, const G4String& name, const G4String& title,
+                    const std::vector<G4String>& columns,
+                    const G4String& profileColumns);
+    void WriteEventRecord(const B4EventRecord& record,
+                          G4AnalysisManager* analysisManager) const;
+
+    G4String GetFileName(const G4Run* run) const;
+#ifdef B4_USE_MPI
+    void MergeRanks(const G4Run* run) const;
+    void ResetHistograms() const;
+#endif
+
+    // the columns of the record rows written to an ntuple
+    struct NtupleOutput {
+      G4bool fActive;
+      G4int fId;                   // ntuple id in the analysis manager
+      G4int fNofValues;            // number of values in each record row
+      std::vector<G4int> fColumns; // record row index of each column
+      std::vector<char> fTypes;    // column type: 'I', 'F' or 'D'
+    };
+
+    static B4EventReorderBuffer* fgReorderBuffer;
+    static G4String fgEnergyLabel;
+    static std::mutex fgEnergyLabelMutex;
+
     B4DetectorConstruction* fDetConstruction;
+    G4GenericMessenger* fMessenger;
+    G4GenericMessenger* fOutputMessenger;
+    G4GenericMessenger* fHistoMessenger;
+    B4SiPMDigitizer* fDigitizer;
+    B4StepProfiler* fStepProfiler;
+    B4StepStreamWriter* fStepStream;
+    B4MemoryMonitor* fMemoryMonitor;
+    B4RunTimer* fRunTimer;
+    B4ShardOutput* fShards;
+    B4JobSplitter* fJob;
+
+    G4bool fBooked;
+    G4String fProfile;
+
+    G4double fEabsMax;
+    G4double fEgapMax;
+    G4bool fShapeHistos;
+    G4bool fShapeActive;
+    G4int fNofRadiusBins;
+    G4double fRadiusMax;
+    G4int fNofTimeBins;
+    G4double fTimeMax;
+    G4int fNofEnergyBins;
+    G4double fEnergyMax;
+    std::vector<NtupleOutput> fNtuples;//[ENtuple]
+    G4bool fReorderOutput;
+    G4bool fReorderActive;
+    G4int fReorderWindow;
+    G4bool fShardOutput;
+    G4int fCompressionLevel;
+    G4int fBasketSize;
+    G4int fBasketEntries;
+    G4bool fShardActive;
+    mutable G4double fWriteTime;
+    G4String fOutputDirectory;
+    G4String fFileNameTemplate;
+    G4String fTmpFileName;
+    G4String fFileName;
+
+    G4int fRunSeed;
+    G4int fRunID;
+    G4int fReplayEventID;
+    G4int fReplayRunID;
 };
 
+// inline functions
+
+inline G4int B4RunAction::GetEventNumber(G4int eventID) const {
+  return ( fReplayEventID >= 0 ) ? fReplayEventID : eventID + fJob->GetEventOffset();
+}
+
+inline G4int B4RunAction::GetRunSeed() const {
+  return fRunSeed;
+}
+
+inline G4int B4RunAction::GetRunID() const {
+  return ( fReplayEventID >= 0 ) ? fReplayRunID : fRunID;
+}
+
+inline const G4String& B4RunAction::GetOutputFileName() const {
+  return fFileName;
+}
+
+inline G4int B4RunAction::GetNofNtuples() const {
+  return kNofNtuples;
+}
+
+inline G4bool B4RunAction::IsNtupleActive(G4int ntuple) const {
+  return fNtuples[ntuple].fActive;
+}
+
+inline const B4SiPMDigitizer* B4RunAction::GetDigitizer() const {
+  return fDigitizer;
+}
+
+inline B4StepProfiler* B4RunAction::GetStepProfiler() const {
+  return fStepProfiler;
+}
+
+inline B4StepStreamWriter* B4RunAction::GetStepStream() const {
+  return fStepStream;
+}
+
+inline B4MemoryMonitor* B4RunAction::GetMemoryMonitor() const {
+  return fMemoryMonitor;
+}
+
+inline B4RunTimer* B4RunAction::GetRunTimer() const {
+  return fRunTimer;
+}
+
+inline G4bool B4RunAction::IsShapeActive() const {
+  return fShapeActive;
+}
+
+inline G4int B4RunAction::GetNofRadiusBins() const {
+  return fNofRadiusBins;
+}
+
+inline G4double B4RunAction::GetRadiusMax() const {
+  return fRadiusMax;
+}
+
+inline G4int B4RunAction::GetNofTimeBins() const {
+  return fNofTimeBins;
+}
+
+inline G4double B4RunAction::GetTimeMax() const {
+  return fTimeMax;
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 #endif
@@ -0,0 +1,114 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4RunTimer.hh
+/// \brief Definition of the B4RunTimer class
+
+#ifndef B4RunTimer_h
+#define B4RunTimer_h 1
+
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+/// Event times and event cost model of the threads.
+///
+/// B4aEventAction passes the wall time and the steps of each event to
+/// AddEventTime() and its CPU time with the primary energy to
+/// AddEventCost(). At the end of run the times of each worker are merged
+/// by Merge(); the master prints the event and idle time of each worker
+/// within its own run time, the events/s, the steps/s and the peak
+/// resident memory with Print() (lines read by benchmark.sh), and fits
+/// the CPU time as a + b*E with WriteCost(), which writes the fit and its
+/// sums in a .cost file next to the output file (read by planSweep.sh).
+
+class B4RunTimer
+{
+  public:
+    B4RunTimer();
+    ~B4RunTimer();
+
+    void BeginOfRun();
+    void AddEventTime(G4double time, G4int nofSteps);
+    void AddEventCost(G4double energy, G4double cpuTime);
+
+    void Merge(G4int nofEvents);
+    void Print(G4int nofEvents) const;
+    void WriteCost(const G4String& fileName) const;
+
+  private:
+    // sums of the least squares fit of the event CPU time (in s)
+    // versus the primary energy (in GeV)
+    struct CostSums {
+      G4double fN;
+      G4double fE;
+      G4double fE2;
+      G4double fT;
+      G4double fET;
+      G4double fT2;
+    };
+
+    struct ThreadTime {
+      G4int fThreadId;
+      G4int fNofEvents;
+      G4double fEventTime;
+      G4double fNofSteps;
+      CostSums fCost;
+    };
+
+    static std::vector<ThreadTime> fgThreads;
+    static std::mutex fgMutex;
+
+    G4double fEventTime;
+    G4double fNofSteps;
+    CostSums fCostSums;
+    std::chrono::steady_clock::time_point fRunStart;
+};
+
+// inline functions
+
+inline void B4RunTimer::AddEventTime(G4double time, G4int nofSteps) {
+  fEventTime += time;
+  fNofSteps += nofSteps;
+}
+
+inline void B4RunTimer::AddEventCost(G4double energy, G4double cpuTime) {
+  G4double e = energy/GeV;
+  G4double t = cpuTime/s;
+  fCostSums.fN += 1.;
+  fCostSums.fE += e;
+  fCostSums.fE2 += e*e;
+  fCostSums.fT += t;
+  fCostSums.fET += e*t;
+  fCostSums.fT2 += t*t;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
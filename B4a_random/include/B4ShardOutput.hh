@@ -0,0 +1,75 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4ShardOutput.hh
+/// \brief Definition of the B4ShardOutput class
+
+#ifndef B4ShardOutput_h
+#define B4ShardOutput_h 1
+
+#include "globals.hh"
+
+#include <mutex>
+#include <vector>
+
+/// Output files written by the threads in a run.
+///
+/// At the end of run each thread which wrote an output file passes it to
+/// Report(), which prints its events, size and write throughput and adds
+/// it to the list of the run. The master then prints the list and, when
+/// the workers wrote their own shard files (/B4/output/shards true),
+/// writes it in a .manifest file next to its output file with
+/// WriteManifest() (read by mergeShards.sh).
+
+class B4ShardOutput
+{
+  public:
+    struct Shard {
+      G4int fThreadId;             // -1 for the master
+      G4String fFileName;
+      G4int fNofEvents;
+      G4double fNofBytes;
+      G4double fWriteTime;
+    };
+
+    B4ShardOutput();
+    ~B4ShardOutput();
+
+    void BeginOfRun();
+    void Report(const G4String& fileName, G4int nofEvents,
+                G4double writeTime, G4int compressionLevel);
+
+    void WriteManifest(const G4String& fileName, G4bool shardFiles) const;
+    std::vector<Shard> GetShards() const;
+
+  private:
+    static std::vector<Shard> fgShards;
+    static std::mutex fgMutex;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,91 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4StepReplay.hh
+/// \brief Definition of the B4StepReplay class
+
+#ifndef B4StepReplay_h
+#define B4StepReplay_h 1
+
+#include "globals.hh"
+#include "B4StepStream.hh"
+
+#include <vector>
+
+class B4RunAction;
+class B4aEventAction;
+class B4aSteppingAction;
+
+/// Replay driver of the step streams.
+///
+/// The events of the step streams written with /B4/stream/capture are read
+/// in memory by ReadStream() and passed by Replay() to the user actions of
+/// a sequential run without Geant4 tracking: for each event
+/// B4aEventAction::BeginOfEventAction(), the numbers of tracks and the
+/// primary condition of the header (as from B4aTrackingAction), each step
+/// to B4aSteppingAction::ProcessStep() and then
+/// B4aEventAction::EndOfEventAction(), within B4RunAction::BeginOfRunAction()
+/// and EndOfRunAction() which write the output file. New event collection
+/// and output code can so be tested on the same inputs in a small fraction
+/// of the simulation time.
+///
+/// The time of the begin of event, of the steps and of the end of event
+/// (with the ntuple fill) are summed over the events and printed by
+/// PrintTimes() for the micro-benchmark of benchB4a.
+
+class B4StepReplay
+{
+  public:
+    B4StepReplay(B4RunAction* runAction, B4aEventAction* eventAction,
+                 B4aSteppingAction* steppingAction);
+    ~B4StepReplay();
+
+    G4int ReadStream(const G4String& fileName);
+    void Replay(G4int nofRepetitions);
+    void PrintTimes() const;
+
+  private:
+    struct StreamEvent {
+      B4StepEventHeader fHeader;
+      std::vector<B4StepRecord> fSteps;
+    };
+
+    B4RunAction* fRunAction;
+    B4aEventAction* fEventAction;
+    B4aSteppingAction* fSteppingAction;
+    std::vector<StreamEvent> fEvents;
+    G4int fRunID;
+
+    G4int fNofEvents;
+    G4double fNofSteps;
+    G4double fBeginTime;
+    G4double fStepTime;
+    G4double fEndTime;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
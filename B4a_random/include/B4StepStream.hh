@@ -0,0 +1,172 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4StepStream.hh
+/// \brief Definition of the B4StepStreamWriter and B4StepStreamReader classes
+
+#ifndef B4StepStream_h
+#define B4StepStream_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+class G4GenericMessenger;
+
+/// The fields of a step used by B4aSteppingAction::ProcessStep():
+/// the volume class, the replica number of the layer (-1 outside the
+/// absorber and gap layers) and the copy number of the tile (-1 outside
+/// the gap), the PDG code, the track and parent IDs, the energy deposit,
+/// the step length, the global time, the pre- and post-step positions and
+/// the post-step momentum and kinetic energy (used for the incident point).
+/// The flags tell whether the particle is charged, whether the step leaves
+/// the world through the calorimeter boundary and whether the process
+/// defining the step is a hadron inelastic interaction.
+
+struct B4StepRecord
+{
+  enum EVolume { kOther = 0, kAbsorber, kGap };
+  enum EFlag { kCharged = 1, kIncident = 2, kHadronInelastic = 4 };
+
+  G4int fVolume;
+  G4int fFlags;
+  G4int fReplicaNo;
+  G4int fCopyNo;
+  G4int fParticle;
+  G4int fTrackID;
+  G4int fParentID;
+  G4double fEdep;
+  G4double fStepLength;
+  G4double fTime;
+  G4ThreeVector fPrePosition;
+  G4ThreeVector fPostPosition;
+  G4ThreeVector fPostMomentum;
+  G4double fPostEnergy;
+};
+
+/// The header of an event in the step stream: the event number, the
+/// numbers of steps and tracks, the primary condition of
+/// B4aEventAction::AddCondition() (generation point, kinetic energy,
+/// momentum) and the end point of the primary.
+
+struct B4StepEventHeader
+{
+  G4int fEventID;
+  G4int fNofSteps;
+  G4int fNofTracks;
+  G4ThreeVector fGenerationPoint;
+  G4double fEnergy;
+  G4ThreeVector fMomentum;
+  G4ThreeVector fVertex;
+};
+
+/// Writer of the step stream.
+///
+/// With /B4/stream/capture true, B4aSteppingAction adds each step with
+/// AddStep() and B4aEventAction writes the steps of the event with
+/// WriteEvent() in a compact binary file,
+/// /B4/stream/fileName + .b4s (+ _t<thread number> for the worker threads).
+/// The values are written in single precision (72 bytes per step).
+/// The file is opened with the first event of a run and closed at the end
+/// of run (B4RunAction), so each run rewrites it.
+/// The recorded streams are replayed without Geant4 tracking by
+/// B4StepReplay (benchB4a).
+
+class B4StepStreamWriter
+{
+  public:
+    B4StepStreamWriter();
+    ~B4StepStreamWriter();
+
+    G4bool IsCapturing() const;
+    void AddStep(const B4StepRecord& step);
+    void WriteEvent(B4StepEventHeader& header);
+    void Close();
+
+    // the step as written in the file
+    struct PackedStep {
+      std::uint8_t fVolume;
+      std::uint8_t fFlags;
+      std::int16_t fReplicaNo;
+      std::int32_t fCopyNo;
+      std::int32_t fParticle;
+      std::int32_t fTrackID;
+      std::int32_t fParentID;
+      float fEdep;
+      float fStepLength;
+      float fTime;
+      float fPrePosition[3];
+      float fPostPosition[3];
+      float fPostMomentum[3];
+      float fPostEnergy;
+    };
+
+  private:
+    void DefineCommands();
+
+    G4GenericMessenger* fMessenger;
+    G4bool fCapture;
+    G4String fFileName;
+    G4String fOpenFileName;
+    std::ofstream fFile;
+    std::vector<PackedStep> fSteps;
+    G4int fNofEvents;
+};
+
+/// Reader of the step stream written by B4StepStreamWriter.
+
+class B4StepStreamReader
+{
+  public:
+    B4StepStreamReader(const G4String& fileName);
+    ~B4StepStreamReader();
+
+    G4bool IsGood() const;
+    G4bool ReadEvent(B4StepEventHeader& header,
+                     std::vector<B4StepRecord>& steps);
+
+  private:
+    std::ifstream fFile;
+    G4bool fGood;
+    std::vector<B4StepStreamWriter::PackedStep> fSteps;
+};
+
+// inline functions
+
+inline G4bool B4StepStreamWriter::IsCapturing() const {
+  return fCapture;
+}
+
+inline G4bool B4StepStreamReader::IsGood() const {
+  return fGood;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
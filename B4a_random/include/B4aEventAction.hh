@@ -34,9 +34,19 @@
 #include "globals.hh"
 
 #include "B4DetectorConstruction.hh"
+#include "B4EventRecord.hh"
+#include "B4SiPMDigitizer.hh"
 
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
 #include <vector>
 
+class B4RunAction;
+class G4GenericMessenger;
+class B4MemoryMonitor;
+
 /// Event action class
 ///
 /// It defines data members to hold the energy deposit and track lengths
@@ -44,29 +54,113 @@
 /// - fEnergyAbs, fEnergyGap, fTrackLAbs, fTrackLGap
 /// which are collected step by step via the functions
 /// - AddAbs(), AddGap()
+/// The truth information of the primary particle is passed once per event
+/// from B4aTrackingAction via AddCondition() and AddVertex(), and the first
+/// hadronic inelastic interaction of the primary via AddShowerStart().
+/// In EndOfEventAction() the ntuple rows are collected in a B4EventRecord
+/// and passed to B4RunAction::FillEvent(). The tile energies and the
+/// Gap_Edep entries are collected only when their ntuple is active in the
+/// output profile.
+///
+/// With /B4/event/timeBin > 0 the Gap_Edep entries of the same layer, tile,
+/// particle and time bin are merged into one hit with the summed energy,
+/// the energy weighted time and the number of contributing steps.
+///
+/// With /B4/event/threshold (in energy) or /B4/event/thresholdMip (in MIP
+/// of B4SiPMDigitizer::GetMipEnergy()) the tiles below the threshold are
+/// not written in Edep and their entries not in Gap_Edep; the energy of
+/// these tiles is summed in the EgapBelow column of the B4 ntuple.
+///
+/// With /B4/event/timeWindow > 0 the tile energies are integrated in the
+/// readout window which starts /B4/event/timeWindowStart after the arrival
+/// of the first particle (the primary in general) at the calorimeter; the
+/// energy deposited outside the window is summed separately (EdepOut,
+/// EgapOut) and the Gap_Edep entries outside the window can be dropped
+/// with /B4/event/dropOutOfWindow.
+///
+/// The shower observables of the in-window tile energies (energy, centre of
+/// gravity, longitudinal and radial RMS, number of tiles above threshold and
+/// the energy per layer) are accumulated in AddGap() and written in the
+/// Shower ntuple.
+///
+/// For the shower shape histograms of B4RunAction the energy is also summed
+/// per time bin (all deposits) and per radial bin around the shower axis
+/// (in-window deposits), and filled at the end of event.
+///
+/// The tiles with an energy deposit are listed in fFiredTiles, so that only
+/// these tiles are written and reset. With /B4/digi/enable the visible
+/// (Birks quenched) energy of the tiles is accumulated as well and the fired
+/// tiles are digitized by B4SiPMDigitizer in EndOfEventAction().
+///
+/// The cost of each event is measured from BeginOfEventAction() to the
+/// start of EndOfEventAction(): the wall time, the CPU time of the thread
+/// and the numbers of steps and tracks (counted by B4aSteppingAction and
+/// B4aTrackingAction) are written in the B4 ntuple, and the CPU time is
+/// passed with the primary energy to the cost model (B4RunTimer) of B4RunAction.
+///
+/// With /B4/stream/capture the header of the event (the primary condition
+/// and the numbers of steps and tracks) and its steps are written in the
+/// step stream of B4RunAction::GetStepStream().
+///
+/// With /B4/memory/monitor the allocations of the event are counted by the
+/// B4MemoryMonitor of B4RunAction, from the start of BeginOfEventAction()
+/// to the end of EndOfEventAction(), and the capacity in bytes of the
+/// per-event buffers is passed to it before the rows are written.
 
 class B4aEventAction : public G4UserEventAction
 {
   public:
-    B4aEventAction(B4DetectorConstruction* detConstruction);
+    B4aEventAction(B4DetectorConstruction* detConstruction,
+                   const B4RunAction* runAction);
     virtual ~B4aEventAction();
 
     virtual void  BeginOfEventAction(const G4Event* event);
     virtual void    EndOfEventAction(const G4Event* event);
     
     void AddAbs(G4double de, G4double dl, G4int lyr);
-    void AddGap(G4double de, G4double dl, G4int lyr, G4int tilex, G4int tiley);
+    void AddGap(G4double de, G4double dl, G4double time, G4int lyr, G4int tilex, G4int tiley);
     void AddTime(G4double de, G4double time, G4int particle, G4int lyr, G4int tilex, G4int tiley);
     void AddCondition(
       G4double genpointx, G4double genpointy, G4double genpointz, 
       G4double kinenergy,
       G4double momentumx, G4double momentumy, G4double momentumz);
-    void AddVertex(G4double vertexx, G4double vertexy, G4double vertexz, G4double detecttime);
-    void AddIncident(G4double incpointx, G4double incpointy, G4int particleID);
-
-    G4double EventInitialInfo;
+    void AddVertex(G4double vertexx, G4double vertexy, G4double vertexz);
+    void AddIncident(
+      G4double incpointx, G4double incpointy, G4double incpointz,
+      G4double incmomentumx, G4double incmomentumy, G4double incmomentumz,
+      G4double incenergy, G4int particleID, G4double inctime);
+    void AddShowerStart(G4int process, G4int lyr,
+      G4double startpointx, G4double startpointy, G4double startpointz);
+    G4bool HasShowerStart() const;
+    void CountStep();
+    void CountTrack();
     
   private:
+    G4bool IsInTimeWindow(G4double time) const;
+
+    // key of a merged Gap_Edep hit
+    struct HitKey {
+      G4int fLayer;
+      G4int fTileX;
+      G4int fTileY;
+      G4int fParticle;
+      G4long fTimeBin;
+      G4bool operator==(const HitKey& other) const {
+        return fLayer == other.fLayer && fTileX == other.fTileX &&
+               fTileY == other.fTileY && fParticle == other.fParticle &&
+               fTimeBin == other.fTimeBin;
+      }
+    };
+    struct HitKeyHash {
+      std::size_t operator()(const HitKey& key) const {
+        std::size_t hash = ((key.fLayer*128 + key.fTileX)*128 + key.fTileY);
+        hash = hash*1000003 ^ static_cast<std::size_t>(key.fParticle);
+        return hash*1000003 ^ static_cast<std::size_t>(key.fTimeBin);
+      }
+    };
+
+    void DefineCommands();
+
     G4double  fEnergyAbs;
     G4double  fEnergyGap;
     G4double  fTrackLAbs; 
@@ -75,6 +169,7 @@ class B4aEventAction : public G4UserEventAction
     G4double  fEnergyAbsbyLyr[48];//[layer]
     G4double  fEnergyGapbyLyr[48][100][100];//[layer][xtile][ytile]
     B4DetectorConstruction* fDetConstruction;
+    const B4RunAction* fRunAction;
 
     std::vector<int> fDetectLayer;
     std::vector<int> fDetectTileX;
@@ -82,6 +177,8 @@ class B4aEventAction : public G4UserEventAction
     std::vector<double> fDetectTime;
     std::vector<double> fDetectEnergy;
     std::vector<double> fDetectPartileID;
+    std::vector<int> fDetectNofSteps;
+    std::unordered_map<HitKey, std::size_t, HitKeyHash> fHitIndex;
 
     G4double fGenerationPointX;
     G4double fGenerationPointY;
@@ -92,13 +189,71 @@ class B4aEventAction : public G4UserEventAction
     G4double fMomentumZ;
     std::vector<double> fIncidentPointX;
     std::vector<double> fIncidentPointY;
+    std::vector<double> fIncidentPointZ;
+    std::vector<double> fIncidentMomentumX;
+    std::vector<double> fIncidentMomentumY;
+    std::vector<double> fIncidentMomentumZ;
+    std::vector<double> fIncidentEnergy;
     std::vector<double> fIncidentID;
     G4double fVertexX;
     G4double fVertexY;
     G4double fVertexZ;
     G4int fParticleNumber;
 
-    G4double vertextime;
+    G4int fStartProcess;
+    G4int fStartLayer;
+    G4double fStartPointX;
+    G4double fStartPointY;
+    G4double fStartPointZ;
+
+    G4bool fCollectTiles;
+    G4bool fCollectTimes;
+    G4bool fDigitize;
+    const B4SiPMDigitizer* fDigitizer;
+    B4MemoryMonitor* fMemoryMonitor;
+
+    std::vector<G4int> fFiredTiles;//[(layer*100+xtile)*100+ytile]
+    std::vector<G4double> fVisibleGap;//[(layer*100+xtile)*100+ytile]
+    std::vector<G4double> fEnergyGapOut;//[(layer*100+xtile)*100+ytile]
+    std::vector<G4double> fFiredVisible;
+    std::vector<G4double> fAmplitude;
+
+    G4GenericMessenger* fMessenger;
+    G4double fTimeBinWidth;
+    G4double fThreshold;
+    G4double fThresholdMip;
+    G4double fTileThreshold;//[energy], from fThreshold or fThresholdMip
+    G4double fEnergyBelow;
+    G4double fTimeWindow;
+    G4double fTimeWindowStart;
+    G4bool fDropOutOfWindow;
+    G4double fArrivalTime;
+
+    G4bool fCollectShower;
+    G4double fTileX0;//[center of the first tile]
+    G4double fTileY0;
+    G4double fTileSize;
+    G4double fLayerZ0;//[center of the first layer]
+    G4double fLayerThickness;
+    G4double fShowerE;
+    G4double fShowerEX;
+    G4double fShowerEY;
+    G4double fShowerEZ;
+    G4double fShowerEX2;
+    G4double fShowerEY2;
+    G4double fShowerEZ2;
+    G4double fShowerEnergybyLyr[48];//[layer]
+
+    G4bool fCollectShape;
+    G4double fShapeTimeBinWidth;
+    std::vector<G4double> fEnergybyTime;//[time bin]
+    std::vector<G4double> fEnergybyRadius;//[radial bin]
+
+    B4EventRecord fRecord;
+    std::chrono::steady_clock::time_point fEventStart;
+    G4double fEventCpuStart;
+    G4int fNofSteps;
+    G4int fNofTracks;
 };
 
 // inline functions
@@ -109,20 +264,73 @@ inline void B4aEventAction::AddAbs(G4double de, G4double dl, G4int lyr = -1) {
   if (lyr != -1) fEnergyAbsbyLyr[lyr] += de;
 }
 
-inline void B4aEventAction::AddGap(G4double de, G4double dl, G4int lyr = -1, G4int tilex = -1, G4int tiley = -1) {
+inline G4bool B4aEventAction::IsInTimeWindow(G4double time) const {
+  if (fTimeWindow <= 0. || fArrivalTime < 0.) return true;
+  auto delay = time - fArrivalTime - fTimeWindowStart;
+  return delay >= 0. && delay < fTimeWindow;
+}
+
+inline void B4aEventAction::AddGap(G4double de, G4double dl, G4double time, G4int lyr = -1, G4int tilex = -1, G4int tiley = -1) {
   fEnergyGap += de; 
   fTrackLGap += dl;
-  if (lyr != -1 && tilex != -1 && tiley != -1) fEnergyGapbyLyr[lyr][tilex][tiley] += de;
+  if (fCollectTiles && lyr != -1 && tilex != -1 && tiley != -1 && de > 0.) {
+    auto tile = (lyr*100 + tilex)*100 + tiley;
+    auto& energy = fEnergyGapbyLyr[lyr][tilex][tiley];
+    if (energy == 0. && (fTimeWindow <= 0. || fEnergyGapOut[tile] == 0.)) {
+      fFiredTiles.push_back(tile);
+    }
+    if (fCollectShape) {
+      auto delay = ( fArrivalTime < 0. ) ? time : time - fArrivalTime;
+      auto bin = static_cast<G4int>(std::floor(delay/fShapeTimeBinWidth));
+      if (bin >= 0 && bin < static_cast<G4int>(fEnergybyTime.size())) fEnergybyTime[bin] += de;
+    }
+    if (IsInTimeWindow(time)) {
+      energy += de;
+      if (fDigitize) fVisibleGap[tile] += fDigitizer->GetVisibleEnergy(de, dl);
+      if (fCollectShower) {
+        auto x = fTileX0 + tilex*fTileSize;
+        auto y = fTileY0 + tiley*fTileSize;
+        auto z = fLayerZ0 + lyr*fLayerThickness;
+        fShowerE += de;
+        fShowerEX += de*x;
+        fShowerEY += de*y;
+        fShowerEZ += de*z;
+        fShowerEX2 += de*x*x;
+        fShowerEY2 += de*y*y;
+        fShowerEZ2 += de*z*z;
+        fShowerEnergybyLyr[lyr] += de;
+      }
+    } else {
+      fEnergyGapOut[tile] += de;
+    }
+  }
 }
 
 inline void B4aEventAction::AddTime(G4double de, G4double time, G4int particle, G4int lyr = -1, G4int tilex = -1, G4int tiley = -1) {
-  if (lyr != -1 && tilex != -1 && tiley != -1) {
+  if (fCollectTimes && lyr != -1 && tilex != -1 && tiley != -1) {
+    if (fDropOutOfWindow && ! IsInTimeWindow(time)) return;
+    if (fTimeBinWidth > 0.) {
+      // merge with the hit of the same tile, particle and time bin;
+      // the time is summed weighted by the energy
+      HitKey key = { lyr, tilex, tiley, particle,
+                     static_cast<G4long>(std::floor(time/fTimeBinWidth)) };
+      auto hit = fHitIndex.emplace(key, fDetectEnergy.size());
+      if (! hit.second) {
+        auto index = hit.first->second;
+        fDetectEnergy[index] += de;
+        fDetectTime[index] += de*time;
+        fDetectNofSteps[index]++;
+        return;
+      }
+      time *= de;
+    }
     fDetectEnergy.push_back(de);
     fDetectTime.push_back(time);
     fDetectLayer.push_back(lyr);
     fDetectTileX.push_back(tilex);
     fDetectTileY.push_back(tiley);
     fDetectPartileID.push_back(particle);
+    fDetectNofSteps.push_back(1);
   }
 }
 
@@ -137,22 +345,49 @@ inline void B4aEventAction::AddCondition(
   fMomentumX = momentumx;
   fMomentumY = momentumy;
   fMomentumZ = momentumz;
-  EventInitialInfo++;
 }
 
-inline void B4aEventAction::AddVertex(G4double vertexx, G4double vertexy, G4double vertexz, G4double detecttime) {
-  if ( detecttime >= vertextime ) {
-    fVertexX = vertexx;
-    fVertexY = vertexy;
-    fVertexZ = vertexz;
-  }
+inline void B4aEventAction::AddVertex(G4double vertexx, G4double vertexy, G4double vertexz) {
+  fVertexX = vertexx;
+  fVertexY = vertexy;
+  fVertexZ = vertexz;
 }
 
-inline void B4aEventAction::AddIncident(G4double incpointx, G4double incpointy, G4int particleID) {
+inline void B4aEventAction::AddIncident(
+  G4double incpointx, G4double incpointy, G4double incpointz,
+  G4double incmomentumx, G4double incmomentumy, G4double incmomentumz,
+  G4double incenergy, G4int particleID, G4double inctime) {
+  if (fArrivalTime < 0.) fArrivalTime = inctime;
   fIncidentPointX.push_back(incpointx);
   fIncidentPointY.push_back(incpointy);
+  fIncidentPointZ.push_back(incpointz);
+  fIncidentMomentumX.push_back(incmomentumx);
+  fIncidentMomentumY.push_back(incmomentumy);
+  fIncidentMomentumZ.push_back(incmomentumz);
+  fIncidentEnergy.push_back(incenergy);
   fIncidentID.push_back(particleID);
 }
+
+inline void B4aEventAction::AddShowerStart(G4int process, G4int lyr,
+  G4double startpointx, G4double startpointy, G4double startpointz) {
+  fStartProcess = process;
+  fStartLayer = lyr;
+  fStartPointX = startpointx;
+  fStartPointY = startpointy;
+  fStartPointZ = startpointz;
+}
+
+inline G4bool B4aEventAction::HasShowerStart() const {
+  return fStartProcess != -1;
+}
+
+inline void B4aEventAction::CountStep() {
+  ++fNofSteps;
+}
+
+inline void B4aEventAction::CountTrack() {
+  ++fNofTracks;
+}
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 #endif
@@ -33,33 +33,62 @@
 #include "G4UserSteppingAction.hh"
 
 #include "B4DetectorConstruction.hh"
+#include "B4StepStream.hh"
 
 class B4DetectorConstruction;
 class B4aEventAction;
+class B4StepProfiler;
+class G4GenericMessenger;
 
 /// Stepping action class.
 ///
-/// In UserSteppingAction() there are collected the energy deposit and track 
-/// lengths of charged particles in Absober and Gap layers and
-/// updated in B4aEventAction.
+/// In UserSteppingAction() the fields of the step used by the user actions
+/// are collected in a B4StepRecord (the positions, the momentum and the
+/// process only for the steps which need them, all fields when the step
+/// stream is captured), which is passed to ProcessStep(): there
+/// are collected the energy deposit and track lengths of charged particles
+/// in Absober and Gap layers and updated in B4aEventAction.
+/// When the step profiling is enabled (/B4/profile/steps), each step is
+/// also counted by the B4StepProfiler of the thread, and with
+/// /B4/stream/capture the step record is added to the step stream of the
+/// thread (B4StepStreamWriter). B4StepReplay passes the recorded steps to
+/// ProcessStep() without Geant4 tracking.
+/// The incident particles and the shower start (and the initial condition
+/// in B4aTrackingAction) are printed only with /B4/step/verbose 1.
 
 class B4aSteppingAction : public G4UserSteppingAction
 {
 public:
   B4aSteppingAction(const B4DetectorConstruction* detectorConstruction,
-                    B4aEventAction* eventAction);
+                    B4aEventAction* eventAction,
+                    B4StepProfiler* stepProfiler,
+                    B4StepStreamWriter* stepStream);
   virtual ~B4aSteppingAction();
 
   virtual void UserSteppingAction(const G4Step* step);
+
+  // the G4Step (nullptr in the replay) is used only for the printout
+  void ProcessStep(const B4StepRecord& record, const G4Step* step = nullptr);
+
+  G4int GetVerboseLevel() const;
     
 private:
+  void DefineCommands();
+
   const B4DetectorConstruction* fDetConstruction;
   B4aEventAction*  fEventAction;
+  B4StepProfiler*  fStepProfiler;
+  B4StepStreamWriter*  fStepStream;
+  B4StepRecord  fRecord;
+  G4GenericMessenger*  fMessenger;
+  G4int  fVerboseLevel;
+};
 
-  G4double WorldEdgeZ;
-  G4double HCalorEdgeZ;
+// inline functions
 
-};
+inline G4int B4aSteppingAction::GetVerboseLevel() const {
+  return fVerboseLevel;
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -0,0 +1,65 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4aTrackingAction.hh
+/// \brief Definition of the B4aTrackingAction class
+
+#ifndef B4aTrackingAction_h
+#define B4aTrackingAction_h 1
+
+#include "G4UserTrackingAction.hh"
+
+class B4aEventAction;
+class B4aSteppingAction;
+
+/// Tracking action class.
+///
+/// The truth information of the primary particle (track 1) is recorded
+/// here once per track instead of on every step:
+/// - PreUserTrackingAction(): generation point, initial energy and momentum
+/// - PostUserTrackingAction(): end point of the primary track
+/// and passed to B4aEventAction, which also counts the tracks of the event.
+/// The initial condition is printed with /B4/step/verbose 1 (see
+/// B4aSteppingAction).
+
+class B4aTrackingAction : public G4UserTrackingAction
+{
+public:
+  B4aTrackingAction(B4aEventAction* eventAction,
+                    const B4aSteppingAction* steppingAction);
+  virtual ~B4aTrackingAction();
+
+  virtual void PreUserTrackingAction(const G4Track* track);
+  virtual void PostUserTrackingAction(const G4Track* track);
+
+private:
+  B4aEventAction*  fEventAction;
+  const B4aSteppingAction*  fSteppingAction;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,42 @@
+# Verify the shards of a split job (/B4/job/beamOn) and merge their files.
+# The manifest entries (.shard) of all shards are checked: every shard is
+# present and complete, the event ranges do not overlap and the files
+# exist; with ROOT in the path, verifyShards.C checks the event numbers
+# in the files. The merged manifest is written next to the output.
+#   ./mergeJobs.sh [output] [shard entries]
+output=${1:-B4_merged.root}
+shift
+if [ $# -eq 0 ]; then set -- *.shard; fi
+manifest=${output%.root}.manifest
+
+awk '!/^#/ {
+  if ( count == "" ) count = $5
+  if ( $5 != count ) { print FILENAME ": shard count " $5 " instead of " count; bad = 1 }
+  seen[$1] = 1; first[$1] = $6; nof[$1] = $7; events[$1] += $3
+}
+END {
+  if ( count == "" ) { print "no shard entries"; exit 1 }
+  for (i = 0; i < count; ++i) {
+    if ( ! (i in seen) ) { print "shard " i " is missing"; bad = 1; continue }
+    if ( events[i] != nof[i] ) {
+      print "shard " i " has " events[i] " of its " nof[i] " events"; bad = 1
+    }
+    for (j = 0; j < i; ++j) {
+      if ( (j in seen) && first[i] < first[j] + nof[j] && first[j] < first[i] + nof[i] ) {
+        print "shards " j " and " i " overlap"; bad = 1
+      }
+    }
+  }
+  exit bad
+}' "$@" || exit 1
+
+grep -h -v "^#" "$@" > ${manifest}
+for file in `awk '{print $2}' ${manifest}`; do
+  [ -f ${file} ] || { echo "${file} is missing"; exit 1; }
+done
+if command -v root > /dev/null; then
+  root -l -b -q "verifyShards.C(\"${manifest}\")" || exit 1
+fi
+echo "`wc -l < ${manifest}` files of $# shard entries verified"
+
+./mergeShards.sh ${manifest} ${output}
@@ -0,0 +1,9 @@
+# Merge the shard files listed in B4.manifest (/B4/output/shards true);
+# the manifest also lists the master file with the histograms.
+#   ./mergeShards.sh [manifest] [output] [number of merge processes]
+manifest=${1:-B4.manifest}
+output=${2:-B4_merged.root}
+jobs=${3:-`nproc`}
+
+shards=`grep -v "^#" ${manifest} | awk '{print $2}'`
+hadd -f -j ${jobs} ${output} ${shards}
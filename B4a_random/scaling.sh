@@ -0,0 +1,19 @@
+# Thread scaling benchmark of the MT and the tasking run managers on the
+# workload of the macro (random energies from 1 to 30 GeV in B4a_random),
+# from 1 to 64 threads. The events/s and the idle time of the threads
+# at the end of the last run are written to scaling.txt.
+#   ./scaling.sh [macro] [number of events] [events per task]
+macro=${1:-scaling.mac}
+export NEVENTS=${2:-2000}
+batch=${3:-1}
+output=scaling.txt
+
+echo "# manager threads events/s idle[%] (${NEVENTS} events, ${batch} events per task)" > ${output}
+for type in MT Tasking; do
+  for threads in 1 2 4 8 16 32 64; do
+    line=`./exampleB4a -m ${macro} -r ${type} -t ${threads} -b ${batch} | grep "events/s)" | tail -1`
+    rate=`echo "${line}" | sed -n -e 's/.*(\([0-9.e+]*\) events\/s).*/\1/p'`
+    idle=`echo "${line}" | sed -n -e 's/.*idle \([0-9.e+-]*\) %.*/\1/p'`
+    echo "${type} ${threads} ${rate:-failed} ${idle:--}" | tee -a ${output}
+  done
+done
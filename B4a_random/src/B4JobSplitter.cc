@@ -0,0 +1,197 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4JobSplitter.cc
+/// \brief Implementation of the B4JobSplitter class
+
+#include "B4JobSplitter.hh"
+#include "B4ShardOutput.hh"
+
+#include "G4RunManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4UImanager.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4JobSplitter::B4JobSplitter()
+ : fMessenger(nullptr),
+   fRunID(-1),
+   fEventOffset(0),
+   fTotalEvents(0),
+   fShardIndex(0),
+   fShardCount(1),
+   fFirstEvent(0),
+   fNofEvents(0)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4JobSplitter::~B4JobSplitter()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4JobSplitter::BeamOn()
+{
+  if ( fShardIndex >= fShardCount ) {
+    G4ExceptionDescription msg;
+    msg << "The shard index " << fShardIndex
+        << " is not smaller than the shard count " << fShardCount;
+    G4Exception("B4JobSplitter::BeamOn()", "B4Job0001", FatalException, msg);
+    return;
+  }
+
+#ifdef B4_USE_MPI
+  // the end of run merges the ranks collectively: a rank without events
+  // would not start a run, and the other ranks would wait for it forever
+  if ( fTotalEvents < fShardCount ) {
+    G4ExceptionDescription msg;
+    msg << "The " << fTotalEvents << " events cannot be split over "
+        << fShardCount << " MPI ranks, each rank needs at least one event.";
+    G4Exception("B4JobSplitter::BeamOn()", "B4Job0002", FatalException, msg);
+  }
+#endif
+
+  // consecutive ranges of event numbers, the first shards get one event
+  // more if the events cannot be divided evenly; the event seeds are
+  // derived from the event numbers, so the shards have disjoint seeds
+  G4int nofEvents = fTotalEvents / fShardCount;
+  G4int remainder = fTotalEvents % fShardCount;
+  fFirstEvent = fShardIndex * nofEvents + std::min(fShardIndex, remainder);
+  if ( fShardIndex < remainder ) ++nofEvents;
+  fNofEvents = nofEvents;
+
+  G4cout << " ----> job shard " << fShardIndex << " of " << fShardCount
+         << " : events " << fFirstEvent << " - "
+         << fFirstEvent + fNofEvents - 1 << G4endl;
+
+  // applied as a command so that it is passed to the workers; the previous
+  // offset is restored for the runs which follow in the same macro
+  auto previousOffset = fEventOffset;
+  std::ostringstream offsetCommand;
+  offsetCommand << "/B4/job/eventOffset " << fFirstEvent;
+  G4UImanager::GetUIpointer()->ApplyCommand(offsetCommand.str());
+
+  if ( fNofEvents > 0 ) {
+    G4RunManager::GetRunManager()->BeamOn(fNofEvents);
+  }
+  fNofEvents = 0;
+
+  std::ostringstream restoreCommand;
+  restoreCommand << "/B4/job/eventOffset " << previousOffset;
+  G4UImanager::GetUIpointer()->ApplyCommand(restoreCommand.str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4JobSplitter::WriteEntry(const G4String& fileName,
+                               const B4ShardOutput* shardOutput,
+                               G4bool shardFiles) const
+{
+  // manifest entry of the output files of this job shard, checked and
+  // merged with the entries of the other shards by mergeJobs.sh;
+  // the worker files are listed only if they hold ntuples (shards)
+  G4String entryName = fileName;
+  entryName.replace(entryName.size() - 5, 5, ".shard");
+  std::ofstream entry(entryName);
+  entry << "# shard file events bytes count firstEvent nofEvents" << std::endl;
+
+  auto shards = shardOutput->GetShards();
+  G4bool workerShards = shardFiles && shards.size() > 1;
+  for (const auto& shard : shards) {
+    if ( ! shardFiles && shard.fThreadId >= 0 ) continue;
+    // the master file holds only the histograms if the workers wrote shards
+    auto nofEvents = ( workerShards && shard.fThreadId < 0 ) ? 0 : shard.fNofEvents;
+    entry << fShardIndex << " " << shard.fFileName << " "
+          << nofEvents << " " << static_cast<long>(shard.fNofBytes)
+          << " " << fShardCount << " " << fFirstEvent << " "
+          << fNofEvents << std::endl;
+  }
+  G4cout << "  job shard " << fShardIndex << " of " << fShardCount
+         << " listed in " << entryName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4JobSplitter::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/job/", "Job control");
+
+  auto& eventOffsetCmd
+    = fMessenger->DeclareProperty("eventOffset", fEventOffset,
+        "Set the number of the first event of the next runs. The event "
+        "numbers (and so the event seeds) of the runs start from it.");
+  eventOffsetCmd.SetParameterName("offset", false);
+  eventOffsetCmd.SetRange("offset>=0");
+  eventOffsetCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& runIDCmd
+    = fMessenger->DeclareProperty("runID", fRunID,
+        "Set the run ID of the seeds and of the RunID column of the next "
+        "runs (-1: the run ID of Geant4).");
+  runIDCmd.SetParameterName("runID", false);
+  runIDCmd.SetRange("runID>=-1");
+  runIDCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& totalEventsCmd
+    = fMessenger->DeclareProperty("totalEvents", fTotalEvents,
+        "Set the number of events of the whole split job.");
+  totalEventsCmd.SetParameterName("nofEvents", false);
+  totalEventsCmd.SetRange("nofEvents>=0");
+  totalEventsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& shardIndexCmd
+    = fMessenger->DeclareProperty("shardIndex", fShardIndex,
+        "Set the index of the shard simulated by this job (from 0).");
+  shardIndexCmd.SetParameterName("index", false);
+  shardIndexCmd.SetRange("index>=0");
+  shardIndexCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& shardCountCmd
+    = fMessenger->DeclareProperty("shardCount", fShardCount,
+        "Set the number of shards of the split job.");
+  shardCountCmd.SetParameterName("count", false);
+  shardCountCmd.SetRange("count>0");
+  shardCountCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // executed by the master only, the workers get the event offset
+  auto& beamOnCmd
+    = fMessenger->DeclareMethod("beamOn", &B4JobSplitter::BeamOn,
+        "Simulate the events of this shard of the split job and write "
+        "the manifest entry of its output files.");
+  beamOnCmd.SetToBeBroadcasted(false);
+  beamOnCmd.SetStates(G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
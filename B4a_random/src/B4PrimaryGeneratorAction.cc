@@ -28,6 +28,7 @@
 /// \brief Implementation of the B4PrimaryGeneratorAction class
 
 #include "B4PrimaryGeneratorAction.hh"
+#include "B4RunAction.hh"
 
 #include "G4RunManager.hh"
 #include "G4LogicalVolumeStore.hh"
@@ -42,11 +43,22 @@
 
 #include "G4RandomDirection.hh"
 
+#include <sstream>
+
+namespace {
+
+// range of the primary energy in GeV
+const G4double MaxEnergy = 30;
+const G4double minEnergy = 1;
+
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-B4PrimaryGeneratorAction::B4PrimaryGeneratorAction()
+B4PrimaryGeneratorAction::B4PrimaryGeneratorAction(const B4RunAction* runAction)
  : G4VUserPrimaryGeneratorAction(),
-   fParticleGun(nullptr)
+   fParticleGun(nullptr),
+   fRunAction(runAction)
 {
   G4int nofParticles = 1;
   fParticleGun = new G4ParticleGun(nofParticles);
@@ -73,6 +85,9 @@ void B4PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
   // This function is called at the begining of event
 
+  // Re-seed the random engine from (run seed, event number)
+  fRunAction->SeedEvent(anEvent->GetEventID());
+
   // In order to avoid dependence of PrimaryGeneratorAction
   // on DetectorConstruction class we get world volume 
   // from G4LogicalVolumeStore
@@ -108,8 +123,6 @@ void B4PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
     ->SetParticlePosition(G4ThreeVector(InitX, InitY, -worldZHalfLength));
   
   // Set particle energy
-  G4double MaxEnergy = 30;
-  G4double minEnergy = 1;
   G4double InitEnergy = (G4UniformRand()*(MaxEnergy-minEnergy)+minEnergy)*GeV;
   G4cout << "Initial Energy: " << InitEnergy << G4endl;
   fParticleGun->SetParticleEnergy(InitEnergy);
@@ -119,3 +132,13 @@ void B4PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+
+G4String B4PrimaryGeneratorAction::GetEnergyLabel() const
+{
+  // the energy is sampled for each event, in GeV
+  std::ostringstream label;
+  label << minEnergy << "-" << MaxEnergy;
+  return label.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
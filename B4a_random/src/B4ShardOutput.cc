@@ -0,0 +1,136 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4ShardOutput.cc
+/// \brief Implementation of the B4ShardOutput class
+
+#include "B4ShardOutput.hh"
+
+#include "G4Threading.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <fstream>
+#include <iomanip>
+
+std::vector<B4ShardOutput::Shard> B4ShardOutput::fgShards;
+std::mutex B4ShardOutput::fgMutex;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4ShardOutput::B4ShardOutput()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4ShardOutput::~B4ShardOutput()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4ShardOutput::BeginOfRun()
+{
+  // the master clears the files of the previous run
+  if ( G4Threading::IsMasterThread() ) {
+    std::lock_guard<std::mutex> lock(fgMutex);
+    fgShards.clear();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4ShardOutput::Report(const G4String& fileName, G4int nofEvents,
+                           G4double writeTime, G4int compressionLevel)
+{
+  Shard shard;
+  shard.fThreadId
+    = G4Threading::IsMasterThread() ? -1 : G4Threading::G4GetThreadId();
+  shard.fFileName = fileName;
+  shard.fNofEvents = nofEvents;
+  shard.fNofBytes = 0.;
+  shard.fWriteTime = writeTime;
+  std::ifstream file(shard.fFileName, std::ios::binary | std::ios::ate);
+  if ( file.good() ) shard.fNofBytes = file.tellg();
+
+  G4cout << " ----> thread " << shard.fThreadId << " wrote "
+         << shard.fNofEvents << " events in " << shard.fWriteTime/s << " s";
+  if ( shard.fNofBytes > 0. && shard.fWriteTime > 0. ) {
+    G4cout << " (" << shard.fFileName << ", "
+           << shard.fNofBytes/1024./1024./(shard.fWriteTime/s) << " MB/s";
+    if ( shard.fNofEvents > 0 ) {
+      G4cout << ", " << shard.fNofBytes/shard.fNofEvents << " bytes/event";
+    }
+    G4cout << ", compression " << compressionLevel << ")";
+  }
+  G4cout << G4endl;
+
+  std::lock_guard<std::mutex> lock(fgMutex);
+  fgShards.push_back(shard);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4ShardOutput::WriteManifest(const G4String& fileName,
+                                  G4bool shardFiles) const
+{
+  // called by the master after all workers finished the run
+  std::lock_guard<std::mutex> lock(fgMutex);
+  if ( fgShards.empty() ) return;
+
+  G4cout << G4endl << " ----> write throughput per thread" << G4endl;
+  G4double totalBytes = 0.;
+  for (const auto& shard : fgShards) {
+    G4cout << "  thread " << std::setw(3) << shard.fThreadId
+           << " : " << std::setw(8) << shard.fNofEvents << " events, "
+           << std::setw(10) << shard.fNofBytes/1024./1024. << " MB, "
+           << std::setw(10) << shard.fWriteTime/s << " s" << G4endl;
+    totalBytes += shard.fNofBytes;
+  }
+
+  if ( ! shardFiles ) return;
+
+  // manifest of the shard files, read by mergeShards.sh
+  G4String manifestName = fileName;
+  manifestName.replace(manifestName.size() - 5, 5, ".manifest");
+  std::ofstream manifest(manifestName);
+  manifest << "# thread file events bytes" << std::endl;
+  for (const auto& shard : fgShards) {
+    manifest << shard.fThreadId << " " << shard.fFileName << " "
+             << shard.fNofEvents << " " << static_cast<long>(shard.fNofBytes)
+             << std::endl;
+  }
+  G4cout << "  " << fgShards.size() << " shard files ("
+         << totalBytes/1024./1024. << " MB) listed in " << manifestName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<B4ShardOutput::Shard> B4ShardOutput::GetShards() const
+{
+  std::lock_guard<std::mutex> lock(fgMutex);
+  return fgShards;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
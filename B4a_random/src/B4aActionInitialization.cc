@@ -32,6 +32,7 @@
 #include "B4RunAction.hh"
 #include "B4aEventAction.hh"
 #include "B4aSteppingAction.hh"
+#include "B4aTrackingAction.hh"
 #include "B4DetectorConstruction.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -58,11 +59,17 @@ void B4aActionInitialization::BuildForMaster() const
 
 void B4aActionInitialization::Build() const
 {
-  SetUserAction(new B4PrimaryGeneratorAction);
-  SetUserAction(new B4RunAction(fDetConstruction));
-  auto eventAction = new B4aEventAction(fDetConstruction);
+  auto runAction = new B4RunAction(fDetConstruction);
+  SetUserAction(runAction);
+  SetUserAction(new B4PrimaryGeneratorAction(runAction));
+  auto eventAction = new B4aEventAction(fDetConstruction, runAction);
   SetUserAction(eventAction);
-  SetUserAction(new B4aSteppingAction(fDetConstruction,eventAction));
+  auto steppingAction
+    = new B4aSteppingAction(fDetConstruction, eventAction,
+                            runAction->GetStepProfiler(),
+                            runAction->GetStepStream());
+  SetUserAction(steppingAction);
+  SetUserAction(new B4aTrackingAction(eventAction, steppingAction));
 }  
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,83 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4aTrackingAction.cc
+/// \brief Implementation of the B4aTrackingAction class
+
+#include "B4aTrackingAction.hh"
+#include "B4aEventAction.hh"
+#include "B4aSteppingAction.hh"
+
+#include "G4Track.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4aTrackingAction::B4aTrackingAction(B4aEventAction* eventAction,
+                                     const B4aSteppingAction* steppingAction)
+  : G4UserTrackingAction(),
+    fEventAction(eventAction),
+    fSteppingAction(steppingAction)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4aTrackingAction::~B4aTrackingAction()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4aTrackingAction::PreUserTrackingAction(const G4Track* track)
+{
+  fEventAction->CountTrack();
+
+  // get event condition from the primary particle
+  if ( track->GetTrackID() != 1 ) return;
+
+  auto vertex = track->GetVertexPosition();
+  auto energy = track->GetKineticEnergy();
+  auto momentum = track->GetMomentum();
+  if ( fSteppingAction->GetVerboseLevel() > 0 ) {
+    G4cout << "--Initial Condition" << G4endl;
+    G4cout << "Initial Point:{" << vertex.x() << " , " << vertex.y() << " , " << vertex.z() << "}" << G4endl;
+    G4cout << "Initial Energy:" << energy << G4endl;
+    G4cout << "Initial Momentum:{" << momentum.x() << " , " << momentum.y() << " , " << momentum.z() << "}" << G4endl;
+  }
+  fEventAction->AddCondition(vertex.x(), vertex.y(), vertex.z(), energy,
+                             momentum.x(), momentum.y(), momentum.z());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4aTrackingAction::PostUserTrackingAction(const G4Track* track)
+{
+  // get ID=1 particle decay point
+  if ( track->GetTrackID() != 1 ) return;
+
+  auto endpoint = track->GetPosition();
+  fEventAction->AddVertex(endpoint.x(), endpoint.y(), endpoint.z());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -29,8 +29,12 @@
 
 #include "B4DetectorConstruction.hh"
 #include "B4aActionInitialization.hh"
+#include "B4ForkRunManager.hh"
 
 #include "G4RunManagerFactory.hh"
+#ifdef G4MULTITHREADED
+#include "G4MTRunManager.hh"
+#endif
 
 #include "G4UImanager.hh"
 #include "G4UIcommand.hh"
@@ -46,9 +50,15 @@
 namespace {
   void PrintUsage() {
     G4cerr << " Usage: " << G4endl;
-    G4cerr << " exampleB4a [-m macro ] [-u UIsession] [-t nThreads]" << G4endl;
-    G4cerr << "   note: -t option is available only for multi-threaded mode."
+    G4cerr << " exampleB4a [-m macro ] [-u UIsession] [-t nThreads]"
+           << " [-r runManagerType] [-b nEventsPerTask] [-p nProcesses]"
            << G4endl;
+    G4cerr << "   note: -t and -b options are available only for"
+           << " multi-threaded mode." << G4endl;
+    G4cerr << "   note: -r option selects Default, Serial, MT, Tasking or TBB;"
+           << " -t is the thread pool size of Tasking." << G4endl;
+    G4cerr << "   note: -p option forks sequential processes after the"
+           << " initialization (-t is then ignored)." << G4endl;
   }
 }
 
@@ -58,23 +68,35 @@ int main(int argc,char** argv)
 {
   // Evaluate arguments
   //
-  if ( argc > 7 ) {
+  if ( argc > 13 ) {
     PrintUsage();
     return 1;
   }
   
   G4String macro;
   G4String session;
+  G4int nProcesses = 0;
+  auto runManagerType = G4RunManagerType::Default;
 #ifdef G4MULTITHREADED
   G4int nThreads = 0;
+  G4int nEventsPerTask = 0;
 #endif
   for ( G4int i=1; i<argc; i=i+2 ) {
     if      ( G4String(argv[i]) == "-m" ) macro = argv[i+1];
     else if ( G4String(argv[i]) == "-u" ) session = argv[i+1];
+    else if ( G4String(argv[i]) == "-p" ) {
+      nProcesses = G4UIcommand::ConvertToInt(argv[i+1]);
+    }
+    else if ( G4String(argv[i]) == "-r" ) {
+      runManagerType = G4RunManagerFactory::GetType(argv[i+1]);
+    }
 #ifdef G4MULTITHREADED
     else if ( G4String(argv[i]) == "-t" ) {
       nThreads = G4UIcommand::ConvertToInt(argv[i+1]);
     }
+    else if ( G4String(argv[i]) == "-b" ) {
+      nEventsPerTask = G4UIcommand::ConvertToInt(argv[i+1]);
+    }
 #endif
     else {
       PrintUsage();
@@ -89,19 +111,32 @@ int main(int argc,char** argv)
     ui = new G4UIExecutive(argc, argv, session);
   }
 
-  // Optionally: choose a different Random engine...
+  // Choose the Random engine
+  // (the seeds of each event are set by B4RunAction::SeedEvent())
   //
-  // G4Random::setTheEngine(new CLHEP::MTwistEngine);
+  G4Random::setTheEngine(new CLHEP::MixMaxRng);
   
-  // Construct the default run manager
+  // Construct the selected (default) run manager, or the sequential
+  // run manager which forks the processes after the initialization
   //
-  auto* runManager =
-    G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+  G4RunManager* runManager = nullptr;
+  if ( nProcesses > 1 ) {
+    runManager = new B4ForkRunManager(nProcesses);
+  }
+  else {
+    runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
 #ifdef G4MULTITHREADED
-  if ( nThreads > 0 ) { 
-    runManager->SetNumberOfThreads(nThreads);
-  }  
+    if ( nThreads > 0 ) { 
+      runManager->SetNumberOfThreads(nThreads);
+    }  
+    // the events are given to the threads (or tasks) in batches of this
+    // size; small batches balance the events of very different costs
+    auto mtRunManager = dynamic_cast<G4MTRunManager*>(runManager);
+    if ( mtRunManager && nEventsPerTask > 0 ) {
+      mtRunManager->SetEventModulo(nEventsPerTask);
+    }
 #endif
+  }
 
   // Set mandatory initialization classes
   //
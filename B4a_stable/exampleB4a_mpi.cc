@@ -0,0 +1,98 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file exampleB4a_mpi.cc
+/// \brief Main program of the B4a example with MPI
+
+#include "B4DetectorConstruction.hh"
+#include "B4aActionInitialization.hh"
+
+#include "G4MPImanager.hh"
+#include "G4MPIsession.hh"
+
+#include "G4RunManagerFactory.hh"
+
+#include "G4UImanager.hh"
+#include "FTFP_BERT.hh"
+
+#include "Randomize.hh"
+
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc,char** argv)
+{
+  // Initialize MPI; the macro file is taken from the arguments:
+  //   mpirun -np <nRanks> exampleB4a_mpi [macro]
+  //
+  auto g4MPI = new G4MPImanager(argc, argv);
+  auto session = g4MPI->GetMPIsession();
+
+  // Choose the Random engine
+  // (the seeds of each event are set by B4RunAction::SeedEvent())
+  //
+  G4Random::setTheEngine(new CLHEP::MixMaxRng);
+
+  // Construct the default run manager; each rank runs its own threads
+  // (set with /run/numberOfThreads)
+  //
+  auto* runManager =
+    G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+
+  // Set mandatory initialization classes
+  //
+  auto detConstruction = new B4DetectorConstruction();
+  runManager->SetUserInitialization(detConstruction);
+
+  auto physicsList = new FTFP_BERT;
+  runManager->SetUserInitialization(physicsList);
+    
+  auto actionInitialization = new B4aActionInitialization(detConstruction);
+  runManager->SetUserInitialization(actionInitialization);
+
+  // Each rank simulates one shard of the events of /B4/job/beamOn,
+  // with its own event numbers and seeds, and writes its own files
+  //
+  auto UImanager = G4UImanager::GetUIpointer();
+  std::ostringstream shardIndexCommand;
+  shardIndexCommand << "/B4/job/shardIndex " << g4MPI->GetRank();
+  UImanager->ApplyCommand(shardIndexCommand.str());
+  std::ostringstream shardCountCommand;
+  shardCountCommand << "/B4/job/shardCount " << g4MPI->GetSize();
+  UImanager->ApplyCommand(shardCountCommand.str());
+
+  // Process macro or start UI session
+  //
+  session->SessionStart();
+
+  // Job termination
+  //
+  delete g4MPI;
+  delete runManager;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo.....
@@ -0,0 +1,85 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4ForkRunManager.hh
+/// \brief Definition of the B4ForkRunManager class
+
+#ifndef B4ForkRunManager_h
+#define B4ForkRunManager_h 1
+
+#include "G4RunManager.hh"
+#include "globals.hh"
+
+/// Sequential run manager which processes each run in several processes.
+///
+/// The geometry and the physics tables are built once in the parent
+/// process (with a run of 0 events), and the parent is then forked into
+/// the given number of child processes which share them copy-on-write.
+/// Each child simulates a disjoint range of event numbers
+/// (/B4/job/eventOffset), so that the seeds of its events derived by
+/// B4RunAction::SeedEvent() are disjoint from those of the other children
+/// and the events are the same as in a single process. Each child writes
+/// its own output file with the suffix _p<process number>.
+///
+/// The parent waits for the children, collects their exit status and
+/// their statistics through a pipe, prints a summary and writes a
+/// manifest of the output files which can be merged with mergeShards.sh.
+
+class B4ForkRunManager : public G4RunManager
+{
+  public:
+    B4ForkRunManager(G4int nofProcesses);
+    virtual ~B4ForkRunManager();
+
+    virtual void BeamOn(G4int nofEvents, const char* macroFile = 0,
+                        G4int nofSelect = -1);
+
+    G4int GetNofProcesses() const;
+
+  private:
+    // statistics sent by a child to the parent at the end of its run
+    struct ProcessReport {
+      G4int fNofEvents;
+      G4double fRealTime;
+      G4double fCpuTime;
+      char fFileName[1024];
+    };
+
+    void RunChild(G4int process, G4int eventOffset, G4int nofEvents,
+                  const char* macroFile, G4int nofSelect, int reportFd);
+
+    G4int fNofProcesses;
+};
+
+// inline functions
+
+inline G4int B4ForkRunManager::GetNofProcesses() const {
+  return fNofProcesses;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,103 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4JobSplitter.hh
+/// \brief Definition of the B4JobSplitter class
+
+#ifndef B4JobSplitter_h
+#define B4JobSplitter_h 1
+
+#include "globals.hh"
+
+class G4GenericMessenger;
+class B4ShardOutput;
+
+/// Split of a production over several jobs (/B4/job/ commands).
+///
+/// The event numbers of the runs, and so their seeds, start from
+/// /B4/job/eventOffset, and /B4/job/runID fixes the run ID of the seeds,
+/// e.g. to the index of the energy in a sweep split over several jobs.
+/// For the array jobs of a batch system, /B4/job/beamOn (BeamOn()) runs
+/// the part of /B4/job/totalEvents selected by shardIndex and shardCount
+/// with the event offset of the shard, and the master lists its output
+/// files in a .shard manifest entry with WriteEntry(), which is checked
+/// and merged with the entries of the other shards by mergeJobs.sh.
+/// In exampleB4a_mpi each MPI rank is a shard.
+
+class B4JobSplitter
+{
+  public:
+    B4JobSplitter();
+    ~B4JobSplitter();
+
+    G4int GetRunID() const;
+    G4int GetEventOffset() const;
+    G4int GetShardIndex() const;
+    G4int GetShardCount() const;
+    G4bool IsShardRun() const;
+
+    void BeamOn();
+    void WriteEntry(const G4String& fileName,
+                    const B4ShardOutput* shardOutput, G4bool shardFiles) const;
+
+  private:
+    void DefineCommands();
+
+    G4GenericMessenger* fMessenger;
+    G4int fRunID;
+    G4int fEventOffset;
+    G4int fTotalEvents;
+    G4int fShardIndex;
+    G4int fShardCount;
+    G4int fFirstEvent;
+    G4int fNofEvents;
+};
+
+// inline functions
+
+inline G4int B4JobSplitter::GetRunID() const {
+  return fRunID;
+}
+
+inline G4int B4JobSplitter::GetEventOffset() const {
+  return fEventOffset;
+}
+
+inline G4int B4JobSplitter::GetShardIndex() const {
+  return fShardIndex;
+}
+
+inline G4int B4JobSplitter::GetShardCount() const {
+  return fShardCount;
+}
+
+inline G4bool B4JobSplitter::IsShardRun() const {
+  return fNofEvents > 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -35,6 +35,7 @@
 
 class G4ParticleGun;
 class G4Event;
+class B4RunAction;
 
 /// The primary generator action class with particle gum.
 ///
@@ -42,21 +43,28 @@ class G4Event;
 /// perpendicular to the input face. The type of the particle
 /// can be changed via the G4 build-in commands of G4ParticleGun class 
 /// (see the macros provided with this example).
+///
+/// The random engine is re-seeded for each event by B4RunAction::SeedEvent()
+/// before the primary particle is generated.
 
 class B4PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
 public:
-  B4PrimaryGeneratorAction();    
+  B4PrimaryGeneratorAction(const B4RunAction* runAction);    
   virtual ~B4PrimaryGeneratorAction();
 
   virtual void GeneratePrimaries(G4Event* event);
   
+  // get methods
+  G4String GetEnergyLabel() const;
+
   // set methods
   void SetRandomFlag(G4bool value);
 
 
 private:
   G4ParticleGun*  fParticleGun; // G4 particle gun
+  const B4RunAction* fRunAction;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,98 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4SiPMDigitizer.hh
+/// \brief Definition of the B4SiPMDigitizer class
+
+#ifndef B4SiPMDigitizer_h
+#define B4SiPMDigitizer_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+class B4DetectorConstruction;
+class G4GenericMessenger;
+
+/// Digitization of the scintillator tiles read out by SiPMs.
+///
+/// The energy deposit of each step is quenched with the Birks law
+/// (GetVisibleEnergy()); the visible energy of the fired tiles is then
+/// digitized in batches by Digitize():
+/// - calibration to photoelectrons with the MIP energy and the light yield,
+/// - saturation of the SiPM pixels,
+/// - Poisson photostatistics and Gaussian electronics noise,
+/// - conversion to MIP and threshold (zero suppression).
+/// The MIP energy is derived from the tile thickness unless it is set.
+/// All parameters are set with the /B4/digi/ commands; the digitization
+/// must be enabled before the first run.
+
+class B4SiPMDigitizer
+{
+  public:
+    B4SiPMDigitizer(const B4DetectorConstruction* detConstruction);
+    ~B4SiPMDigitizer();
+
+    G4bool IsEnabled() const;
+    G4double GetMipEnergy() const;
+    G4double GetVisibleEnergy(G4double edep, G4double stepLength) const;
+
+    void Digitize(const std::vector<G4double>& visibleEnergy,
+                  std::vector<G4double>& amplitude) const;
+
+  private:
+    void DefineCommands();
+
+    const B4DetectorConstruction* fDetConstruction;
+    G4GenericMessenger* fMessenger;
+
+    G4bool fEnabled;
+    G4double fMipdEdx;        // MIP energy loss per unit length in the tile
+    G4double fMipEnergy;      // MIP energy, 0 = from the tile thickness
+    G4double fBirksConstant;
+    G4double fLightYield;     // photoelectrons per MIP
+    G4double fNofPixels;      // 0 = no saturation
+    G4bool fPhotostatistics;
+    G4double fNoise;          // in photoelectrons
+    G4double fThreshold;      // in MIP
+};
+
+// inline functions
+
+inline G4bool B4SiPMDigitizer::IsEnabled() const {
+  return fEnabled;
+}
+
+inline G4double B4SiPMDigitizer::GetVisibleEnergy(G4double edep,
+                                                  G4double stepLength) const {
+  // the steps without length (neutral particles) are not quenched
+  if ( fBirksConstant <= 0. || stepLength <= 0. ) return edep;
+  return edep/(1. + fBirksConstant*edep/stepLength);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
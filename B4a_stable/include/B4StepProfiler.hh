@@ -0,0 +1,122 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4StepProfiler.hh
+/// \brief Definition of the B4StepProfiler class
+
+#ifndef B4StepProfiler_h
+#define B4StepProfiler_h 1
+
+#include "globals.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+class G4Step;
+class G4LogicalVolume;
+class G4ParticleDefinition;
+class G4VProcess;
+class G4GenericMessenger;
+
+/// Step profiling counters.
+///
+/// With /B4/profile/steps true, B4aSteppingAction passes each step to
+/// Record(), which counts the steps, the time and the deposited energy
+/// per (logical volume, particle, process defining the step) in counters
+/// of the thread. The time of a step is the time since the previous step
+/// of the thread (the first step of an event is counted without time).
+/// When the profiling is off, the stepping action only tests IsEnabled().
+///
+/// At the end of run the counters of each thread are merged by Merge(),
+/// and the master prints the steps with the largest time and writes the
+/// full table with Write(); the table is converted to histograms
+/// by plotSteps.C.
+
+class B4StepProfiler
+{
+  public:
+    B4StepProfiler();
+    ~B4StepProfiler();
+
+    G4bool IsEnabled() const;
+    void Record(const G4Step* step);
+
+    void Clear();
+    void Merge();
+    void Write(const G4String& fileName) const;
+
+  private:
+    void DefineCommands();
+
+    struct Key {
+      const G4LogicalVolume* fVolume;
+      const G4ParticleDefinition* fParticle;
+      const G4VProcess* fProcess;
+      G4bool operator==(const Key& other) const {
+        return fVolume == other.fVolume && fParticle == other.fParticle &&
+               fProcess == other.fProcess;
+      }
+    };
+    struct KeyHash {
+      std::size_t operator()(const Key& key) const {
+        std::hash<const void*> hash;
+        return hash(key.fVolume) ^ (hash(key.fParticle) << 1)
+             ^ (hash(key.fProcess) << 2);
+      }
+    };
+    struct Counter {
+      G4double fNofSteps;
+      G4double fTime;
+      G4double fEdep;
+    };
+    // the processes are thread local, the merged counters are keyed by
+    // the names of the volume, the particle and the process
+    typedef std::tuple<G4String, G4int, G4String, G4String> NameKey;
+
+    static std::map<NameKey, Counter> fgCounters;
+    static std::mutex fgMutex;
+
+    G4GenericMessenger* fMessenger;
+    G4bool fEnabled;
+    G4int fNofPrintedRows;
+    std::unordered_map<Key, Counter, KeyHash> fCounters;
+    std::chrono::steady_clock::time_point fLastStep;
+};
+
+// inline functions
+
+inline G4bool B4StepProfiler::IsEnabled() const {
+  return fEnabled;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,11 @@
+# Run one shard of a split job (/B4/job/beamOn, see pi_job.mac), e.g. as
+# an array job of a batch system; the shard index is taken from the
+# argument or from the array index of SLURM or PBS.
+#   ./runShard.sh [macro] [number of shards] [shard index]
+# All shards on the local machine:
+#   for i in `seq 0 7`; do ./runShard.sh pi_job.mac 8 $i & done; wait
+macro=${1:-pi_job.mac}
+count=${2:-${SHARD_COUNT:-1}}
+index=${3:-${SLURM_ARRAY_TASK_ID:-${PBS_ARRAYID:-0}}}
+
+SHARD_INDEX=${index} SHARD_COUNT=${count} ./exampleB4a -m ${macro}
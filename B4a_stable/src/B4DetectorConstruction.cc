@@ -65,6 +65,9 @@ B4DetectorConstruction::B4DetectorConstruction()
 {
   fNModuleX = 10;
   fNModuleY = 10; 
+  fHGapThickness = 0.;
+  fHTileSize = 0.;
+  fHLayerThickness = 0.;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -121,7 +124,10 @@ G4VPhysicalVolume* B4DetectorConstruction::DefineVolumes()
   G4int nofHLayers = 48;
   G4double habsThickness = 20.*mm;
   G4double hgapThickness = 3.*mm;
+  fHGapThickness = hgapThickness;
   G4double hgapSideLength = 1.*cm;
+  fHTileSize = hgapSideLength;
+  fHLayerThickness = habsThickness + hgapThickness;
   auto hcalorSizeZ = (habsThickness+hgapThickness)*nofHLayers;
 
   // Geometry parameters
@@ -0,0 +1,204 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4EventReorderBuffer.cc
+/// \brief Implementation of the B4EventReorderBuffer class
+
+#include "B4EventReorderBuffer.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+  // maximum time a thread waits for the missing events before it exceeds
+  // the window (protects against events which are never submitted)
+  const std::chrono::seconds kStallTimeout(60);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4EventReorderBuffer::B4EventReorderBuffer()
+ : fStopping(false),
+   fWindow(1),
+   fNextEventID(0),
+   fPendingBytes(0),
+   fPeakPendingBytes(0),
+   fPeakPendingEvents(0),
+   fNofStalls(0),
+   fNofOverflows(0),
+   fNofViolations(0),
+   fStallTime(0.)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4EventReorderBuffer::~B4EventReorderBuffer()
+{
+  Flush();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4EventReorderBuffer::Start(G4int window, Writer writer)
+{
+  // the writer thread of a previous run is stopped first
+  Flush();
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fPending.clear();
+  fStopping = false;
+  fWriter = writer;
+  fWindow = ( window > 0 ) ? window : 1;
+  fNextEventID = 0;
+  fPendingBytes = 0;
+  fPeakPendingBytes = 0;
+  fPeakPendingEvents = 0;
+  fNofStalls = 0;
+  fNofOverflows = 0;
+  fNofViolations = 0;
+  fStallTime = 0.;
+  fWriterThread = std::thread(&B4EventReorderBuffer::WriteEvents, this);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4EventReorderBuffer::Submit(B4EventRecord& record)
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  auto eventID = record.GetEventID();
+
+  // wait while the event is beyond the reorder window
+  if ( eventID >= fNextEventID + fWindow ) {
+    ++fNofStalls;
+    auto start = std::chrono::steady_clock::now();
+    auto inWindow = [this, eventID]() { return eventID < fNextEventID + fWindow; };
+    if ( ! fCondition.wait_for(lock, kStallTimeout, inWindow) ) {
+      // give up the missing events and continue from the oldest waiting one
+      ++fNofOverflows;
+      auto nextEventID = eventID;
+      if ( ! fPending.empty() && fPending.begin()->first < eventID ) {
+        nextEventID = fPending.begin()->first;
+      }
+      fNextEventID = std::max(fNextEventID, nextEventID);
+      fReadyCondition.notify_one();
+    }
+    std::chrono::duration<G4double> stall = std::chrono::steady_clock::now() - start;
+    fStallTime += stall.count()*s;
+  }
+
+  fPendingBytes += record.GetNofBytes();
+  fPending.emplace(eventID, std::move(record));
+
+  // the caller continues with a written record and its capacity
+  if ( ! fFreeRecords.empty() ) {
+    record = std::move(fFreeRecords.back());
+    fFreeRecords.pop_back();
+  }
+  if ( fPendingBytes > fPeakPendingBytes ) fPeakPendingBytes = fPendingBytes;
+  if ( fPending.size() > fPeakPendingEvents ) fPeakPendingEvents = fPending.size();
+  if ( fPending.begin()->first <= fNextEventID ) fReadyCondition.notify_one();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4EventReorderBuffer::Flush()
+{
+  // the writer thread writes the remaining events (in order, skipping
+  // the missing ones) before it stops
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStopping = true;
+  }
+  fReadyCondition.notify_one();
+  if ( fWriterThread.joinable() ) fWriterThread.join();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4EventReorderBuffer::PrintStatistics() const
+{
+  G4cout
+    << G4endl
+    << " ----> event reorder buffer (window " << fWindow << " events)" << G4endl
+    << "  peak buffered events : " << fPeakPendingEvents << G4endl
+    << "  peak buffered memory : " << fPeakPendingBytes/1024./1024. << " MB" << G4endl
+    << "  stalled submissions  : " << fNofStalls
+    << " (" << fNofOverflows << " exceeded the window)" << G4endl
+    << "  total stall time     : " << fStallTime/s << " s" << G4endl
+    << "  order violations     : " << fNofViolations << G4endl;
+
+  if ( fNofViolations > 0 ) {
+    G4ExceptionDescription msg;
+    msg << fNofViolations << " events were submitted after the reorder window"
+        << " had moved past them and were written out of the event ID order;"
+        << " increase /B4/output/reorderWindow.";
+    G4Exception("B4EventReorderBuffer::PrintStatistics()", "B4Reorder0001",
+                JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4EventReorderBuffer::WriteEvents()
+{
+  // the body of the writer thread; the events are written outside the
+  // lock, so that the workers can submit meanwhile
+  std::unique_lock<std::mutex> lock(fMutex);
+  while ( true ) {
+    auto ready = [this]() {
+      return fStopping ||
+             ( ! fPending.empty() && fPending.begin()->first <= fNextEventID ); };
+    fReadyCondition.wait(lock, ready);
+
+    if ( fPending.empty() ) {
+      if ( fStopping ) return;
+      continue;
+    }
+    auto it = fPending.begin();
+    if ( it->first > fNextEventID && ! fStopping ) continue;
+
+    // a late event behind the cursor does not move it back
+    if ( it->first < fNextEventID ) ++fNofViolations;
+    fNextEventID = std::max(fNextEventID, it->first + 1);
+    auto record = std::move(it->second);
+    fPendingBytes -= record.GetNofBytes();
+    fPending.erase(it);
+    fCondition.notify_all();
+
+    lock.unlock();
+    fWriter(record);
+    lock.lock();
+
+    // at most one free record per waiting event is kept
+    if ( fFreeRecords.size() < static_cast<std::size_t>(fWindow) ) {
+      fFreeRecords.push_back(std::move(record));
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,246 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4ForkRunManager.cc
+/// \brief Implementation of the B4ForkRunManager class
+
+#include "B4ForkRunManager.hh"
+#include "B4RunAction.hh"
+
+#include "G4Run.hh"
+#include "G4UImanager.hh"
+#include "G4UIcommand.hh"
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4ForkRunManager::B4ForkRunManager(G4int nofProcesses)
+ : G4RunManager(),
+   fNofProcesses(nofProcesses)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4ForkRunManager::~B4ForkRunManager()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4ForkRunManager::BeamOn(G4int nofEvents, const char* macroFile,
+                              G4int nofSelect)
+{
+  if ( fNofProcesses < 2 || nofEvents <= 0 ) {
+    G4RunManager::BeamOn(nofEvents, macroFile, nofSelect);
+    return;
+  }
+
+  if ( ! ConfirmBeamOnCondition() ) return;
+
+  // build the physics tables in the parent, so that they are shared
+  // copy-on-write by the children instead of being built in each of them
+  G4RunManager::BeamOn(0);
+
+  // the children continue the event numbers and the file name of the parent
+  auto UImanager = G4UImanager::GetUIpointer();
+  G4String offset = UImanager->GetCurrentValues("/B4/job/eventOffset");
+  auto firstEvent = G4UIcommand::ConvertToInt(offset.c_str());
+  G4String fileName = UImanager->GetCurrentValues("/B4/output/fileName");
+
+  G4cout << G4endl << " ----> forking " << fNofProcesses
+         << " processes for " << nofEvents << " events" << G4endl;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<pid_t> pids(fNofProcesses, -1);
+  std::vector<int> reportFds(fNofProcesses, -1);
+  for (G4int i = 0; i < fNofProcesses; ++i) {
+    auto nofProcessEvents = nofEvents / fNofProcesses
+                          + ( i < nofEvents % fNofProcesses ? 1 : 0 );
+    if ( nofProcessEvents == 0 ) continue;
+
+    int fds[2];
+    if ( pipe(fds) != 0 ) {
+      G4Exception("B4ForkRunManager::BeamOn()", "B4Fork0001", JustWarning,
+                  "Cannot create a pipe, the remaining processes are not forked.");
+      break;
+    }
+
+    G4cout.flush();
+    auto pid = fork();
+    if ( pid == 0 ) {
+      close(fds[0]);
+      for (auto fd : reportFds) {
+        if ( fd >= 0 ) close(fd);
+      }
+      std::ostringstream offsetCommand;
+      offsetCommand << "/B4/job/eventOffset " << firstEvent;
+      UImanager->ApplyCommand(offsetCommand.str());
+      std::ostringstream fileNameCommand;
+      fileNameCommand << "/B4/output/fileName " << fileName << "_p" << i;
+      UImanager->ApplyCommand(fileNameCommand.str());
+      RunChild(i, firstEvent, nofProcessEvents, macroFile, nofSelect, fds[1]);
+    }
+
+    close(fds[1]);
+    if ( pid < 0 ) {
+      close(fds[0]);
+      G4Exception("B4ForkRunManager::BeamOn()", "B4Fork0001", JustWarning,
+                  "Cannot fork, the remaining processes are not forked.");
+      break;
+    }
+    pids[i] = pid;
+    reportFds[i] = fds[0];
+    firstEvent += nofProcessEvents;
+  }
+
+  // collect the reports and the exit status of the children
+  G4cout << G4endl << " ----> statistics per process" << G4endl;
+  std::vector<ProcessReport> reports;
+  std::vector<G4int> processes;
+  G4int nofFailed = 0;
+  G4int totalEvents = 0;
+  G4double totalCpuTime = 0.;
+  for (G4int i = 0; i < fNofProcesses; ++i) {
+    if ( pids[i] < 0 ) continue;
+
+    ProcessReport report;
+    std::memset(&report, 0, sizeof(report));
+    auto nofBytes = read(reportFds[i], &report, sizeof(report));
+    close(reportFds[i]);
+    int status = 0;
+    waitpid(pids[i], &status, 0);
+
+    if ( nofBytes != sizeof(report) || ! WIFEXITED(status)
+         || WEXITSTATUS(status) != 0 ) {
+      G4cout << "  process " << std::setw(3) << i << " (pid " << pids[i]
+             << ") failed";
+      if ( WIFSIGNALED(status) ) G4cout << " with signal " << WTERMSIG(status);
+      else if ( WIFEXITED(status) ) G4cout << " with status " << WEXITSTATUS(status);
+      G4cout << G4endl;
+      ++nofFailed;
+      continue;
+    }
+
+    G4cout << "  process " << std::setw(3) << i
+           << " : " << std::setw(8) << report.fNofEvents << " events, "
+           << std::setw(10) << report.fRealTime << " s real, "
+           << std::setw(10) << report.fCpuTime << " s cpu, "
+           << report.fFileName << G4endl;
+    totalEvents += report.fNofEvents;
+    totalCpuTime += report.fCpuTime;
+    reports.push_back(report);
+    processes.push_back(i);
+  }
+  std::chrono::duration<G4double> realTime
+    = std::chrono::steady_clock::now() - start;
+
+  G4cout << "  total : " << totalEvents << " events in "
+         << realTime.count() << " s real, " << totalCpuTime << " s cpu";
+  if ( realTime.count() > 0. ) {
+    G4cout << " (" << totalEvents / realTime.count() << " events/s)";
+  }
+  G4cout << G4endl;
+
+  if ( nofFailed > 0 ) {
+    G4ExceptionDescription msg;
+    msg << nofFailed << " of the forked processes failed, "
+        << "their events are missing in the output.";
+    G4Exception("B4ForkRunManager::BeamOn()", "B4Fork0002", JustWarning, msg);
+  }
+
+  // manifest of the output files of the children, read by mergeShards.sh
+  if ( ! reports.empty() ) {
+    G4String manifestName = reports.front().fFileName;
+    std::ostringstream suffix;
+    suffix << "_p" << processes.front();
+    auto pos = manifestName.rfind(suffix.str());
+    if ( pos != std::string::npos ) manifestName.erase(pos, suffix.str().size());
+    manifestName.replace(manifestName.size() - 5, 5, ".manifest");
+
+    std::ofstream manifest(manifestName);
+    manifest << "# process file events bytes" << std::endl;
+    for (std::size_t i = 0; i < reports.size(); ++i) {
+      std::ifstream file(reports[i].fFileName, std::ios::binary | std::ios::ate);
+      long nofFileBytes = file.good() ? static_cast<long>(file.tellg()) : 0;
+      manifest << processes[i] << " " << reports[i].fFileName << " "
+               << reports[i].fNofEvents << " " << nofFileBytes << std::endl;
+    }
+    G4cout << "  " << reports.size() << " output files listed in "
+           << manifestName << G4endl;
+  }
+
+  // the children used the current run ID, the next run gets a new one
+  SetRunIDCounter(runIDCounter + 1);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4ForkRunManager::RunChild(G4int process, G4int eventOffset,
+                                G4int nofEvents, const char* macroFile,
+                                G4int nofSelect, int reportFd)
+{
+  G4cout << " ----> process " << process << " (pid " << getpid()
+         << ") : events " << eventOffset << " - "
+         << eventOffset + nofEvents - 1 << G4endl;
+
+  ProcessReport report;
+  std::memset(&report, 0, sizeof(report));
+
+  auto start = std::chrono::steady_clock::now();
+  auto cpuStart = std::clock();
+  G4RunManager::BeamOn(nofEvents, macroFile, nofSelect);
+  std::chrono::duration<G4double> realTime
+    = std::chrono::steady_clock::now() - start;
+
+  report.fRealTime = realTime.count();
+  report.fCpuTime = static_cast<G4double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  auto run = GetCurrentRun();
+  report.fNofEvents = run ? run->GetNumberOfEvent() : 0;
+  auto runAction = dynamic_cast<const B4RunAction*>(GetUserRunAction());
+  if ( runAction ) {
+    std::strncpy(report.fFileName, runAction->GetOutputFileName().c_str(),
+                 sizeof(report.fFileName) - 1);
+  }
+
+  auto status = ( write(reportFd, &report, sizeof(report)) == sizeof(report) )
+              ? 0 : 1;
+  close(reportFd);
+
+  // leave without deleting the objects inherited from the parent
+  G4cout.flush();
+  _exit(status);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
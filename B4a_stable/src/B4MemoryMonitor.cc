@@ -0,0 +1,390 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4MemoryMonitor.cc
+/// \brief Implementation of the B4MemoryMonitor class
+
+#include "B4MemoryMonitor.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+
+#include <sys/resource.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace {
+
+// the counters of the allocations of the thread, filled by the operators below
+std::atomic<bool> countAllocations(false);
+thread_local std::uint64_t nofAllocations = 0;
+thread_local std::uint64_t nofAllocatedBytes = 0;
+thread_local std::int64_t heapBytes = 0;
+thread_local std::int64_t peakHeapBytes = 0;
+
+// the size of an allocated block, its requested size when it is unknown
+inline std::size_t BlockSize(void* pointer, std::size_t size) {
+#if defined(__GLIBC__)
+  return malloc_usable_size(pointer);
+#else
+  (void)pointer;
+  return size;
+#endif
+}
+
+inline void* Allocate(std::size_t size, std::size_t alignment = 0) {
+  void* pointer = nullptr;
+  if ( alignment == 0 ) {
+    pointer = std::malloc(size > 0 ? size : 1);
+  }
+  else {
+    // the size of an aligned block is a multiple of the alignment
+    auto alignedSize = ( size + alignment - 1 ) / alignment * alignment;
+    pointer = aligned_alloc(alignment, alignedSize > 0 ? alignedSize : alignment);
+  }
+  if ( pointer && countAllocations.load(std::memory_order_relaxed) ) {
+    auto nofBytes = BlockSize(pointer, size);
+    ++nofAllocations;
+    nofAllocatedBytes += nofBytes;
+    heapBytes += nofBytes;
+    if ( heapBytes > peakHeapBytes ) peakHeapBytes = heapBytes;
+  }
+  return pointer;
+}
+
+inline void Free(void* pointer) {
+#if defined(__GLIBC__)
+  // the blocks allocated before the start of run are counted as well,
+  // so that the heap bytes of a thread can become negative
+  if ( pointer && countAllocations.load(std::memory_order_relaxed) ) {
+    heapBytes -= malloc_usable_size(pointer);
+  }
+#endif
+  std::free(pointer);
+}
+
+// the resident memory of the process in bytes
+G4double PeakResidentBytes() {
+  struct rusage usage;
+  if ( getrusage(RUSAGE_SELF, &usage) != 0 ) return 0.;
+  return usage.ru_maxrss * 1024.;
+}
+
+G4double ResidentBytes() {
+  long nofPages = 0, nofResidentPages = 0;
+  std::ifstream statm("/proc/self/statm");
+  if ( ! ( statm >> nofPages >> nofResidentPages ) ) return 0.;
+  return static_cast<G4double>(nofResidentPages) * sysconf(_SC_PAGESIZE);
+}
+
+const char* bufferNames[B4MemoryMonitor::kNofBuffers] = {
+  "hits", "hitIndex", "incidents", "firedTiles", "digitization",
+  "timeWindow", "eventRecord"
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void* operator new(std::size_t size)
+{
+  auto pointer = Allocate(size);
+  if ( ! pointer ) throw std::bad_alloc();
+  return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+  Free(pointer);
+}
+
+#ifdef __cpp_aligned_new
+// the over-aligned allocations are counted as well
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  auto pointer = Allocate(size, static_cast<std::size_t>(alignment));
+  if ( ! pointer ) throw std::bad_alloc();
+  return pointer;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept
+{
+  return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept
+{
+  return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t,
+                     const std::nothrow_t&) noexcept
+{
+  Free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t,
+                       const std::nothrow_t&) noexcept
+{
+  Free(pointer);
+}
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<B4MemoryMonitor::ThreadMemory> B4MemoryMonitor::fgThreads;
+std::mutex B4MemoryMonitor::fgMutex;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4MemoryMonitor::B4MemoryMonitor()
+ : fMessenger(nullptr),
+   fEnabled(false),
+   fThread(),
+   fEventAllocations(0),
+   fEventBytes(0)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4MemoryMonitor::~B4MemoryMonitor()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4MemoryMonitor::BeginOfRun()
+{
+  // the master starts its run before the workers
+  if ( G4Threading::IsMasterThread() ) {
+    countAllocations.store(fEnabled, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(fgMutex);
+    fgThreads.clear();
+  }
+
+  fThread = ThreadMemory();
+  fThread.fThreadId = G4Threading::G4GetThreadId();
+  heapBytes = 0;
+  peakHeapBytes = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4MemoryMonitor::BeginEvent()
+{
+  fEventAllocations = nofAllocations;
+  fEventBytes = nofAllocatedBytes;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4MemoryMonitor::EndEvent()
+{
+  G4double allocations = nofAllocations - fEventAllocations;
+  G4double bytes = nofAllocatedBytes - fEventBytes;
+
+  ++fThread.fNofEvents;
+  fThread.fAllocations += allocations;
+  fThread.fMaxAllocations = std::max(fThread.fMaxAllocations, allocations);
+  fThread.fBytes += bytes;
+  fThread.fMaxBytes = std::max(fThread.fMaxBytes, bytes);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4MemoryMonitor::Merge()
+{
+  // the master of a multi-threaded run has no events
+  if ( fThread.fNofEvents == 0 ) return;
+
+  fThread.fPeakHeap = peakHeapBytes;
+  std::lock_guard<std::mutex> lock(fgMutex);
+  fgThreads.push_back(fThread);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4MemoryMonitor::Write(const G4String& fileName) const
+{
+  // called by the master after all threads were merged
+  std::lock_guard<std::mutex> lock(fgMutex);
+  countAllocations.store(false, std::memory_order_relaxed);
+  if ( fgThreads.empty() ) return;
+
+  std::vector<ThreadMemory> rows(fgThreads);
+  std::sort(rows.begin(), rows.end(),
+    [](const ThreadMemory& a, const ThreadMemory& b)
+    { return a.fThreadId < b.fThreadId; });
+
+  G4cout << G4endl << " ----> memory per thread (peak RSS "
+         << PeakResidentBytes()/(1024.*1024.) << " MB, current RSS "
+         << ResidentBytes()/(1024.*1024.) << " MB)" << G4endl;
+  G4double buffers[kNofBuffers] = {};
+  G4double totalPeakHeap = 0.;
+  auto flags = G4cout.flags();
+  auto precision = G4cout.precision();
+  for (const auto& row : rows) {
+    G4cout << "  thread " << std::setw(3) << row.fThreadId
+           << " : " << std::setw(8) << row.fNofEvents << " events, "
+           << std::fixed << std::setprecision(0)
+           << std::setw(10) << row.fAllocations/row.fNofEvents
+           << " allocs/event (max " << row.fMaxAllocations << "), "
+           << std::setprecision(1)
+           << std::setw(10) << row.fBytes/row.fNofEvents/1024.
+           << " kB/event (max " << row.fMaxBytes/1024. << "), peak heap "
+           << std::setw(8) << row.fPeakHeap/(1024.*1024.) << " MB" << G4endl;
+    G4cout.flags(flags);
+    G4cout.precision(precision);
+    totalPeakHeap += row.fPeakHeap;
+    for (G4int i = 0; i < kNofBuffers; ++i) {
+      buffers[i] = std::max(buffers[i], row.fBuffers[i]);
+    }
+  }
+  G4cout << "  sum of the peak heaps : " << totalPeakHeap/(1024.*1024.)
+         << " MB" << G4endl;
+  G4cout << "  high-water capacity of the per-event buffers :" << G4endl;
+  for (G4int i = 0; i < kNofBuffers; ++i) {
+    G4cout << "  " << std::setw(14) << bufferNames[i] << " : "
+           << buffers[i]/1024. << " kB" << G4endl;
+  }
+
+  // full table, one row per thread
+  G4String tableName = fileName;
+  tableName.replace(tableName.size() - 5, 5, ".memory");
+  std::ofstream table(tableName);
+  table << "# thread events allocsPerEvent maxAllocs bytesPerEvent maxBytes"
+        << " peakHeap[bytes]";
+  for (G4int i = 0; i < kNofBuffers; ++i) table << " " << bufferNames[i];
+  table << std::endl;
+  for (const auto& row : rows) {
+    table << row.fThreadId << " " << row.fNofEvents << " "
+          << row.fAllocations/row.fNofEvents << " " << row.fMaxAllocations << " "
+          << row.fBytes/row.fNofEvents << " " << row.fMaxBytes << " "
+          << row.fPeakHeap;
+    for (G4int i = 0; i < kNofBuffers; ++i) table << " " << row.fBuffers[i];
+    table << std::endl;
+  }
+  G4cout << "  " << rows.size() << " rows written in " << tableName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4MemoryMonitor::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/memory/", "Memory monitoring");
+
+  auto& monitorCmd
+    = fMessenger->DeclareProperty("monitor", fEnabled,
+        "Count the allocations and the allocated bytes per event and thread, "
+        "and the high-water capacity of the per-event buffers.");
+  monitorCmd.SetParameterName("monitor", true);
+  monitorCmd.SetDefaultValue("true");
+  monitorCmd.SetStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
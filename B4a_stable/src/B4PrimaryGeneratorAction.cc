@@ -28,6 +28,7 @@
 /// \brief Implementation of the B4PrimaryGeneratorAction class
 
 #include "B4PrimaryGeneratorAction.hh"
+#include "B4RunAction.hh"
 
 #include "G4RunManager.hh"
 #include "G4LogicalVolumeStore.hh"
@@ -42,11 +43,14 @@
 
 #include "G4RandomDirection.hh"
 
+#include <sstream>
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-B4PrimaryGeneratorAction::B4PrimaryGeneratorAction()
+B4PrimaryGeneratorAction::B4PrimaryGeneratorAction(const B4RunAction* runAction)
  : G4VUserPrimaryGeneratorAction(),
-   fParticleGun(nullptr)
+   fParticleGun(nullptr),
+   fRunAction(runAction)
 {
   G4int nofParticles = 1;
   fParticleGun = new G4ParticleGun(nofParticles);
@@ -73,6 +77,9 @@ void B4PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
   // This function is called at the begining of event
 
+  // Re-seed the random engine from (run seed, event number)
+  fRunAction->SeedEvent(anEvent->GetEventID());
+
   // In order to avoid dependence of PrimaryGeneratorAction
   // on DetectorConstruction class we get world volume 
   // from G4LogicalVolumeStore
@@ -112,3 +119,13 @@ void B4PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+
+G4String B4PrimaryGeneratorAction::GetEnergyLabel() const
+{
+  // energy set by /gun/energy, in GeV
+  std::ostringstream label;
+  label << fParticleGun->GetParticleEnergy()/GeV;
+  return label.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -30,19 +30,109 @@
 #include <sstream>
 
 #include "B4RunAction.hh"
+#include "B4PrimaryGeneratorAction.hh"
 #include "B4Analysis.hh"
+#include "B4EventRecord.hh"
+#include "B4EventReorderBuffer.hh"
+#include "B4SiPMDigitizer.hh"
+#include "B4StepProfiler.hh"
+#include "B4StepStream.hh"
+#include "B4MemoryMonitor.hh"
+#include "B4RunTimer.hh"
+#include "B4ShardOutput.hh"
 
 #include "G4Run.hh"
 #include "G4RunManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#ifdef B4_USE_MPI
+#include "G4MPImanager.hh"
+#include "G4MPIhistoMerger.hh"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+
+namespace {
+
+// start of the program, for the startup time printed in the first run
+const auto programStart = std::chrono::steady_clock::now();
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4EventReorderBuffer* B4RunAction::fgReorderBuffer = nullptr;
+G4String B4RunAction::fgEnergyLabel;
+std::mutex B4RunAction::fgEnergyLabelMutex;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 B4RunAction::B4RunAction(B4DetectorConstruction* detConstruction)
  : G4UserRunAction(),
-   fDetConstruction(detConstruction)
+   fDetConstruction(detConstruction),
+   fMessenger(nullptr),
+   fOutputMessenger(nullptr),
+   fHistoMessenger(nullptr),
+   fDigitizer(nullptr),
+   fStepProfiler(nullptr),
+   fStepStream(nullptr),
+   fMemoryMonitor(nullptr),
+   fRunTimer(nullptr),
+   fShards(nullptr),
+   fJob(nullptr),
+   fBooked(false),
+   fProfile("full"),
+   fEabsMax(6*GeV),
+   fEgapMax(1*GeV),
+   fShapeHistos(false),
+   fShapeActive(false),
+   fNofRadiusBins(50),
+   fRadiusMax(250*mm),
+   fNofTimeBins(100),
+   fTimeMax(200*ns),
+   fNofEnergyBins(100),
+   fEnergyMax(100*MeV),
+   fNtuples(kNofNtuples),
+   fReorderOutput(false),
+   fReorderActive(false),
+   fReorderWindow(1000),
+   fShardOutput(false),
+   fCompressionLevel(1),
+   fBasketSize(32000),
+   fBasketEntries(4000),
+   fShardActive(false),
+   fWriteTime(0.),
+   fOutputDirectory(""),
+   fFileNameTemplate("B4"),
+   fTmpFileName(""),
+   fFileName(""),
+   fRunSeed(1),
+   fRunID(0),
+   fReplayEventID(-1),
+   fReplayRunID(0)
 { 
+  DefineCommands();
+  fDigitizer = new B4SiPMDigitizer(detConstruction);
+  fStepProfiler = new B4StepProfiler();
+  fStepStream = new B4StepStreamWriter();
+  fMemoryMonitor = new B4MemoryMonitor();
+  fRunTimer = new B4RunTimer();
+  fShards = new B4ShardOutput();
+  fJob = new B4JobSplitter();
+
+  // the reorder buffer is shared by all threads and owned by the master
+  if ( G4Threading::IsMasterThread() ) {
+    fgReorderBuffer = new B4EventReorderBuffer();
+  }
   
   // set printing event number per each event
   G4RunManager::GetRunManager()->SetPrintProgress(1);     
@@ -57,94 +147,297 @@ B4RunAction::B4RunAction(B4DetectorConstruction* detConstruction)
   //analysisManager->SetHistoDirectoryName("histograms");
   //analysisManager->SetNtupleDirectoryName("ntuple");
   analysisManager->SetVerboseLevel(1);
-  analysisManager->SetNtupleMerging(true);
+
+  // Book histograms, ntuple in the first BeginOfRunAction()
+  // (after the output options were set)
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4RunAction::~B4RunAction()
+{
+  if ( G4Threading::IsMasterThread() ) {
+    delete fgReorderBuffer;
+    fgReorderBuffer = nullptr;
+  }
+  delete fMessenger;
+  delete fOutputMessenger;
+  delete fHistoMessenger;
+  delete fDigitizer;
+  delete fStepProfiler;
+  delete fStepStream;
+  delete fMemoryMonitor;
+  delete fRunTimer;
+  delete fShards;
+  delete fJob;
+  delete G4AnalysisManager::Instance();  
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunAction::Book()
+{
+  auto analysisManager = G4AnalysisManager::Instance();
+
+  // In the shard mode each worker writes its own ntuple file,
+  // in the reorder mode the writer thread of the master writes all ntuple rows,
+  // otherwise the worker ntuples are merged in the master file
+  fShardActive = fShardOutput;
+  // (a sequential run writes its events in order anyway)
+  fReorderActive = fReorderOutput && ! fShardActive
+                && G4Threading::IsMultithreadedApplication();
+  if ( fReorderOutput && fShardActive && isMaster ) {
+    G4ExceptionDescription msg;
+    msg << "The shard files are written in the event order of each thread,"
+        << " /B4/output/reorder is ignored.";
+    G4Exception("B4RunAction::Book()", "B4Output0001", JustWarning, msg);
+  }
+  analysisManager->SetNtupleMerging(! fReorderActive && ! fShardActive);
     // Note: merging ntuples is available only with Root output
 
   // Book histograms, ntuple
   //
   
   // Creating histograms
-  analysisManager->CreateH1("Eabs","Edep in absorber", 100, 0., 6*GeV);
-  analysisManager->CreateH1("Egap","Edep in gap", 100, 0., 1*GeV);
+  analysisManager->CreateH1("Eabs","Edep in absorber", 100, 0., fEabsMax);
+  analysisManager->CreateH1("Egap","Edep in gap", 100, 0., fEgapMax);
   analysisManager->CreateH1("Labs","trackL in absorber", 100, 0., 5*m);
   analysisManager->CreateH1("Lgap","trackL in gap", 100, 0., 2*m);
+
+  // Shower shape histograms: energy per event in each bin of
+  // the layer, the radial distance and the time
+  fShapeActive = fShapeHistos;
+  if ( fShapeActive ) {
+    analysisManager->CreateH2("ELayerH2", "Edep in gap vs layer",
+      48, 0., 48., fNofEnergyBins, 0., fEnergyMax, "none", "MeV");
+    analysisManager->CreateH2("ERadiusH2", "Edep in gap vs radius",
+      fNofRadiusBins, 0., fRadiusMax, fNofEnergyBins, 0., fEnergyMax,
+      "mm", "MeV");
+    analysisManager->CreateH2("ETimeH2", "Edep in gap vs time",
+      fNofTimeBins, 0., fTimeMax, fNofEnergyBins, 0., fEnergyMax,
+      "ns", "MeV");
+    analysisManager->CreateP1("ELayer", "Mean Edep in gap vs layer",
+      48, 0., 48., 0., 0., "none", "MeV");
+    analysisManager->CreateP1("ERadius", "Mean Edep in gap vs radius",
+      fNofRadiusBins, 0., fRadiusMax, 0., 0., "mm", "MeV");
+    analysisManager->CreateP1("ETime", "Mean Edep in gap vs time",
+      fNofTimeBins, 0., fTimeMax, 0., 0., "ns", "MeV");
+  }
   
 
+  // Columns of each ntuple in the output profile:
+  // "*" = all columns in double precision, "" = ntuple not produced,
+  // otherwise the list of the columns written with their type (I, F or D)
+  std::vector<G4String> profile;
+  if ( fProfile == "cnn" ) {
+    profile = { "Event/I EgapBelow/F",
+                "Enumber/I Lnumber/I TXnumber/I TYnumber/I GorA/I Edep/F",
+                "",
+                "Enumber/I InEnergy/F ParticleID/I StartProcess/I StartLayer/I "
+                "IncEnergy/F RunSeed/I RunID/I",
+                "Enumber/I Lnumber/I TXnumber/I TYnumber/I Amplitude/F",
+                "" };
+  }
+  else if ( fProfile == "timing" ) {
+    profile = { "*",
+                "",
+                "Enumber/I Lnumber/I TXnumber/I TYnumber/I Edep/F Time/D "
+                "ParticlID/I NSteps/I",
+                "*",
+                "",
+                "" };
+  }
+  else if ( fProfile == "resolution" ) {
+    profile = { "*", "", "", "", "", "*" };
+  }
+  else {
+    profile = { "*", "*", "*", "*", "*", "*" };
+  }
+
   // Creating ntuple
   //
-  analysisManager->CreateNtuple("B4", "Edep and TrackL");
-  analysisManager->CreateNtupleDColumn("Eabs");
-  analysisManager->CreateNtupleDColumn("Egap");
-  analysisManager->CreateNtupleDColumn("Labs");
-  analysisManager->CreateNtupleDColumn("Lgap");
-  analysisManager->CreateNtupleDColumn("Event");
-  analysisManager->FinishNtuple();
-  
-  analysisManager->CreateNtuple("Edep", "Each Part Energy Deposit");
-  analysisManager->CreateNtupleDColumn("Enumber");
-  analysisManager->CreateNtupleDColumn("Lnumber");
-  analysisManager->CreateNtupleDColumn("TXnumber");
-  analysisManager->CreateNtupleDColumn("TYnumber");
-  analysisManager->CreateNtupleDColumn("GorA");
-  analysisManager->CreateNtupleDColumn("Edep");
-  analysisManager->FinishNtuple();
+  BookNtuple(kEventNtuple, "B4", "Edep and TrackL",
+    { "Eabs", "Egap", "Labs", "Lgap", "Event", "EgapBelow", "EgapOut",
+      "WallTime", "CpuTime", "NSteps", "NTracks" },
+    profile[kEventNtuple]);
 
-  analysisManager->CreateNtuple("Gap_Edep", "Detect Time in Gap");
-  analysisManager->CreateNtupleDColumn("Enumber");
-  analysisManager->CreateNtupleDColumn("Lnumber");
-  analysisManager->CreateNtupleDColumn("TXnumber");
-  analysisManager->CreateNtupleDColumn("TYnumber");
-  analysisManager->CreateNtupleDColumn("Edep");
-  analysisManager->CreateNtupleDColumn("Time");
-  analysisManager->CreateNtupleDColumn("ParticlID");
-  analysisManager->FinishNtuple();
+  BookNtuple(kEdepNtuple, "Edep", "Each Part Energy Deposit",
+    { "Enumber", "Lnumber", "TXnumber", "TYnumber", "GorA", "Edep",
+      "EdepOut" },
+    profile[kEdepNtuple]);
 
-  analysisManager->CreateNtuple("Event_Condition", "Event Condition");
-  analysisManager->CreateNtupleDColumn("Enumber");
-  analysisManager->CreateNtupleDColumn("GenPointX");
-  analysisManager->CreateNtupleDColumn("GenPointY");
-  analysisManager->CreateNtupleDColumn("GenPointZ");
-  analysisManager->CreateNtupleDColumn("InEnergy");
-  analysisManager->CreateNtupleDColumn("MomentumX");
-  analysisManager->CreateNtupleDColumn("MomentumY");
-  analysisManager->CreateNtupleDColumn("MomentumZ");
-  analysisManager->CreateNtupleDColumn("IncPointX");
-  analysisManager->CreateNtupleDColumn("IncPointY");
-  analysisManager->CreateNtupleDColumn("VerPointX");
-  analysisManager->CreateNtupleDColumn("VerPointY");
-  analysisManager->CreateNtupleDColumn("VerPointZ");
-  analysisManager->CreateNtupleDColumn("PNumber");
-  analysisManager->CreateNtupleDColumn("ParticleID");
-  analysisManager->FinishNtuple();
+  BookNtuple(kGapEdepNtuple, "Gap_Edep", "Detect Time in Gap",
+    { "Enumber", "Lnumber", "TXnumber", "TYnumber", "Edep", "Time",
+      "ParticlID", "NSteps" },
+    profile[kGapEdepNtuple]);
+
+  BookNtuple(kConditionNtuple, "Event_Condition", "Event Condition",
+    { "Enumber", "GenPointX", "GenPointY", "GenPointZ", "InEnergy",
+      "MomentumX", "MomentumY", "MomentumZ", "IncPointX", "IncPointY",
+      "VerPointX", "VerPointY", "VerPointZ", "PNumber", "ParticleID",
+      "StartProcess", "StartLayer", "StartPointX", "StartPointY", "StartPointZ",
+      "IncPointZ", "IncMomentumX", "IncMomentumY", "IncMomentumZ", "IncEnergy",
+      "RunSeed", "RunID" },
+    profile[kConditionNtuple]);
+
+  BookNtuple(kDigiNtuple, "Digi", "Digitized Tile Amplitude",
+    { "Enumber", "Lnumber", "TXnumber", "TYnumber", "Amplitude" },
+    fDigitizer->IsEnabled() ? profile[kDigiNtuple] : "");
+
+  std::vector<G4String> showerColumns
+    = { "Enumber", "Energy", "CogX", "CogY", "CogZ", "RmsZ", "RmsR", "NHits" };
+  for (G4int l = 0; l < 48; ++l) {
+    std::ostringstream column;
+    column << "ELayer" << std::setw(2) << std::setfill('0') << l;
+    showerColumns.push_back(column.str());
+  }
+  BookNtuple(kShowerNtuple, "Shower", "Shower Observables",
+    showerColumns, profile[kShowerNtuple]);
+
+  if ( isMaster ) {
+    G4cout << "Output profile: " << fProfile << G4endl;
+  }
+  fBooked = true;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-B4RunAction::~B4RunAction()
+void B4RunAction::BookNtuple(G4int ntuple, const G4String& name,
+                             const G4String& title,
+                             const std::vector<G4String>& columns,
+                             const G4String& profileColumns)
 {
-  delete G4AnalysisManager::Instance();  
+  auto& output = fNtuples[ntuple];
+  output.fActive = ! profileColumns.empty();
+  output.fId = -1;
+  output.fNofValues = columns.size();
+  output.fColumns.clear();
+  output.fTypes.clear();
+  if ( ! output.fActive ) return;
+
+  // select the columns of the profile
+  if ( profileColumns == "*" ) {
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+      output.fColumns.push_back(i);
+      output.fTypes.push_back('D');
+    }
+  }
+  else {
+    std::istringstream is(profileColumns);
+    G4String column;
+    while ( is >> column ) {
+      auto slash = column.find('/');
+      auto columnName = column.substr(0, slash);
+      auto type = ( slash != std::string::npos ) ? column[slash+1] : 'D';
+      std::size_t i = 0;
+      while ( i < columns.size() && columns[i] != columnName ) ++i;
+      if ( i == columns.size() ) {
+        G4ExceptionDescription msg;
+        msg << "Column " << columnName << " not found in ntuple " << name;
+        G4Exception("B4RunAction::BookNtuple()", "B4Output0003",
+          FatalException, msg);
+        return;
+      }
+      output.fColumns.push_back(i);
+      output.fTypes.push_back(type);
+    }
+  }
+
+  auto analysisManager = G4AnalysisManager::Instance();
+  output.fId = analysisManager->CreateNtuple(name, title);
+  for (std::size_t i = 0; i < output.fColumns.size(); ++i) {
+    const auto& columnName = columns[output.fColumns[i]];
+    switch ( output.fTypes[i] ) {
+      case 'I': analysisManager->CreateNtupleIColumn(columnName); break;
+      case 'F': analysisManager->CreateNtupleFColumn(columnName); break;
+      default:  analysisManager->CreateNtupleDColumn(columnName); break;
+    }
+  }
+  analysisManager->FinishNtuple();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void B4RunAction::BeginOfRunAction(const G4Run* /*run*/)
+void B4RunAction::BeginOfRunAction(const G4Run* run)
 { 
-  //inform the runManager to save random number seed
-  //G4RunManager::GetRunManager()->SetRandomNumberStore(true);
+  // the seeds of each event are derived from the run seed and the run ID
+  // (see SeedEvent()), so the random number status of the events does not
+  // need to be saved; /B4/job/runID replaces the run ID of Geant4
+  fRunID = ( fJob->GetRunID() >= 0 ) ? fJob->GetRunID() : run->GetRunID();
+  if ( isMaster ) {
+    G4cout << "Run seed: " << fRunSeed << ", run ID: " << fRunID;
+    if ( fReplayEventID >= 0 ) {
+      G4cout << " (replay of event " << fReplayEventID << " of run "
+             << fReplayRunID << ")";
+    }
+    G4cout << G4endl;
+  }
+
+  if ( ! fBooked ) {
+    if ( isMaster ) {
+      std::chrono::duration<G4double> startupTime
+        = std::chrono::steady_clock::now() - programStart;
+      G4cout << " ----> startup time " << startupTime.count() << " s" << G4endl;
+    }
+    Book();
+  }
   
   // Get analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
 
-  // Open an output file
+  // The compression and the baskets are applied when the file is opened
+  analysisManager->SetCompressionLevel(fCompressionLevel);
+  analysisManager->SetBasketSize(fBasketSize);
+  analysisManager->SetBasketEntries(fBasketEntries);
+
+  // Open an output file under a temporary name unique to this job and run;
+  // it is renamed to the file name template at the end of run
   //
-  G4String fileName = "B4";
-  analysisManager->OpenFile(fileName);
+  std::ostringstream tmpFileName;
+  if ( ! fOutputDirectory.empty() ) tmpFileName << fOutputDirectory << "/";
+  tmpFileName << "B4tmp_" << getpid();
+  if ( fJob->GetShardCount() > 1 ) {
+    tmpFileName << "_j" << fJob->GetShardIndex();
+  }
+  tmpFileName << "_r" << run->GetRunID() << ".root";
+  fTmpFileName = tmpFileName.str();
+  analysisManager->OpenFile(fTmpFileName);
+  fWriteTime = 0.;
+  fRunTimer->BeginOfRun();
+  fShards->BeginOfRun();
+  fStepProfiler->Clear();
+  fMemoryMonitor->BeginOfRun();
+  if ( isMaster ) {
+    std::lock_guard<std::mutex> lock(fgEnergyLabelMutex);
+    fgEnergyLabel = "";
+  }
+
+  // The writer thread of the reorder buffer fills the master's ntuples in
+  // order for all threads; the master does not use its analysis manager
+  // until the buffer is flushed at the start of its EndOfRunAction()
+  if ( fReorderActive && isMaster ) {
+    fgReorderBuffer->Start(fReorderWindow,
+      [this, analysisManager](const B4EventRecord& record) {
+        WriteEventRecord(record, analysisManager); });
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void B4RunAction::EndOfRunAction(const G4Run* /*run*/)
+void B4RunAction::EndOfRunAction(const G4Run* run)
 {
+  // write the events still waiting in the reorder buffer and stop its
+  // writer thread (the workers have finished their events)
+  if ( fReorderActive && isMaster ) {
+    fgReorderBuffer->Flush();
+    fgReorderBuffer->PrintStatistics();
+  }
+
+#ifdef B4_USE_MPI
+  // the histograms and statistics of all ranks are merged to rank 0
+  if ( isMaster ) MergeRanks(run);
+#endif
+
   // print histogram statistics
   //
   auto analysisManager = G4AnalysisManager::Instance();
@@ -178,10 +471,411 @@ void B4RunAction::EndOfRunAction(const G4Run* /*run*/)
       << G4BestUnit(analysisManager->GetH1(3)->rms(),  "Length") << G4endl;
   }
 
+#ifdef B4_USE_MPI
+  // the histograms of the other ranks are written in the rank 0 file only,
+  // so that the files of all ranks can be merged with hadd
+  if ( isMaster && G4MPImanager::GetManager()->GetRank() != 0 ) {
+    ResetHistograms();
+  }
+#endif
+
   // save histograms & ntuple
   //
+  auto start = std::chrono::steady_clock::now();
   analysisManager->Write();
   analysisManager->CloseFile();
+  std::chrono::duration<G4double> closeTime = std::chrono::steady_clock::now() - start;
+  fWriteTime += closeTime.count()*s;
+
+  // the worker files are suffixed with the thread number by the
+  // analysis manager when the ntuples are not merged
+  G4String threadSuffix = "";
+  if ( ! isMaster ) {
+    std::ostringstream suffix;
+    suffix << "_t" << G4Threading::G4GetThreadId();
+    threadSuffix = suffix.str();
+  }
+  G4String tmpFileName = fTmpFileName;
+  tmpFileName.insert(tmpFileName.size() - 5, threadSuffix);
+
+  // In the reorder mode the worker ntuples stay empty,
+  // the worker file is used only to merge the histograms
+  if ( fReorderActive && ! isMaster ) {
+    std::remove(tmpFileName.c_str());
+  }
+
+  // move the closed file to its final name; the rename within the output
+  // directory is atomic, so a file with the final name is always complete
+  fFileName = GetFileName(run);
+  if ( ! isMaster && fFileNameTemplate.find("%t") == std::string::npos ) {
+    fFileName.insert(fFileName.size() - 5, threadSuffix);
+  }
+  std::ifstream tmpFile(tmpFileName);
+  if ( tmpFile.good() ) {
+    tmpFile.close();
+    if ( std::rename(tmpFileName.c_str(), fFileName.c_str()) != 0 ) {
+      G4ExceptionDescription msg;
+      msg << "Cannot rename " << tmpFileName << " to " << fFileName;
+      G4Exception("B4RunAction::EndOfRunAction()", "B4Output0002",
+        JustWarning, msg);
+    }
+  }
+
+  // report the written file and the write throughput;
+  // in the reorder mode all rows are written by the master
+  if ( isMaster || ! fReorderActive ) {
+    fShards->Report(fFileName, run->GetNumberOfEvent(), fWriteTime,
+                    fCompressionLevel);
+  }
+
+  fStepStream->Close();
+
+  // the step profile of the workers is merged before the master's end of run
+  if ( fStepProfiler->IsEnabled() ) fStepProfiler->Merge();
+  if ( fMemoryMonitor->IsEnabled() ) fMemoryMonitor->Merge();
+
+  if ( isMaster ) {
+    fShards->WriteManifest(fFileName, fShardActive);
+    if ( fJob->IsShardRun() ) {
+      fJob->WriteEntry(fFileName, fShards, fShardActive);
+    }
+    fRunTimer->Print(run->GetNumberOfEvent());
+    fRunTimer->WriteCost(fFileName);
+    if ( fStepProfiler->IsEnabled() ) fStepProfiler->Write(fFileName);
+    if ( fMemoryMonitor->IsEnabled() ) fMemoryMonitor->Write(fFileName);
+  }
+  else {
+    fRunTimer->Merge(run->GetNumberOfEvent());
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunAction::FillEvent(B4EventRecord& record) const
+{
+  if ( fReorderActive ) {
+    fgReorderBuffer->Submit(record);
+  }
+  else {
+    WriteEventRecord(record, G4AnalysisManager::Instance());
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunAction::WriteEventRecord(const B4EventRecord& record,
+                                   G4AnalysisManager* analysisManager) const
+{
+  auto start = std::chrono::steady_clock::now();
+  for (G4int ntuple = 0; ntuple < record.GetNofNtuples(); ++ntuple) {
+    const auto& output = fNtuples[ntuple];
+    if ( ! output.fActive ) continue;
+    const auto& rows = record.GetRows(ntuple);
+    auto nofColumns = output.fColumns.size();
+    for (std::size_t row = 0; row < rows.size(); row += output.fNofValues) {
+      for (std::size_t column = 0; column < nofColumns; ++column) {
+        auto value = rows[row + output.fColumns[column]];
+        switch ( output.fTypes[column] ) {
+          case 'I':
+            analysisManager->FillNtupleIColumn(output.fId, column,
+                                               static_cast<G4int>(value));
+            break;
+          case 'F':
+            analysisManager->FillNtupleFColumn(output.fId, column,
+                                               static_cast<G4float>(value));
+            break;
+          default:
+            analysisManager->FillNtupleDColumn(output.fId, column, value);
+            break;
+        }
+      }
+      analysisManager->AddNtupleRow(output.fId);
+    }
+  }
+  std::chrono::duration<G4double> fillTime = std::chrono::steady_clock::now() - start;
+  fWriteTime += fillTime.count()*s;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String B4RunAction::GetFileName(const G4Run* run) const
+{
+  // the energy label is taken from the primary generator of this thread,
+  // or from the label published by the workers on the master
+  auto generatorAction = static_cast<const B4PrimaryGeneratorAction*>(
+    G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+  G4String energyLabel;
+  {
+    std::lock_guard<std::mutex> lock(fgEnergyLabelMutex);
+    if ( generatorAction ) {
+      energyLabel = generatorAction->GetEnergyLabel();
+      if ( fgEnergyLabel.empty() ) fgEnergyLabel = energyLabel;
+    }
+    else {
+      energyLabel = fgEnergyLabel;
+    }
+  }
+
+  std::ostringstream fileName;
+  if ( ! fOutputDirectory.empty() ) fileName << fOutputDirectory << "/";
+  for (std::size_t i = 0; i < fFileNameTemplate.size(); ++i) {
+    if ( fFileNameTemplate[i] != '%' || i+1 == fFileNameTemplate.size() ) {
+      fileName << fFileNameTemplate[i];
+      continue;
+    }
+    switch ( fFileNameTemplate[++i] ) {
+      case 'e': fileName << energyLabel; break;
+      case 's': fileName << fRunSeed; break;
+      case 'r': fileName << run->GetRunID(); break;
+      case 'j': fileName << fJob->GetShardIndex(); break;
+      case 't':
+        if ( isMaster ) fileName << "master";
+        else fileName << G4Threading::G4GetThreadId();
+        break;
+      default: fileName << fFileNameTemplate[i]; break;
+    }
+  }
+  // the job shards are suffixed with the shard index
+  if ( fJob->GetShardCount() > 1
+       && fFileNameTemplate.find("%j") == std::string::npos ) {
+    fileName << "_j" << fJob->GetShardIndex();
+  }
+  fileName << ".root";
+
+  return fileName.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifdef B4_USE_MPI
+void B4RunAction::MergeRanks(const G4Run* run) const
+{
+  // collective over all ranks, each rank must run the same number of runs
+  auto mpiManager = G4MPImanager::GetManager();
+  G4MPIhistoMerger histoMerger(G4AnalysisManager::Instance());
+  histoMerger.Merge();
+
+  G4int nofEvents = run->GetNumberOfEvent();
+  G4int counts[2] = { nofEvents, -nofEvents };
+  G4int totalEvents = 0;
+  G4int extremes[2] = { 0, 0 };
+  MPI_Reduce(&nofEvents, &totalEvents, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Reduce(counts, extremes, 2, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  if ( mpiManager->GetRank() == 0 ) {
+    G4cout << G4endl << " ----> " << totalEvents << " events on "
+           << mpiManager->GetSize() << " ranks (" << -extremes[1]
+           << " - " << extremes[0] << " events per rank)" << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunAction::ResetHistograms() const
+{
+  auto analysisManager = G4AnalysisManager::Instance();
+  for (G4int i = 0; i < analysisManager->GetNofH1s(); ++i) {
+    if ( analysisManager->GetH1(i) ) analysisManager->GetH1(i)->reset();
+  }
+  for (G4int i = 0; i < analysisManager->GetNofH2s(); ++i) {
+    if ( analysisManager->GetH2(i) ) analysisManager->GetH2(i)->reset();
+  }
+  for (G4int i = 0; i < analysisManager->GetNofP1s(); ++i) {
+    if ( analysisManager->GetP1(i) ) analysisManager->GetP1(i)->reset();
+  }
+}
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunAction::SeedEvent(G4int eventID) const
+{
+  // Derive two independent seeds from (run seed, run ID, event number) with
+  // the SplitMix64 generator, so that any event can be reproduced alone
+  auto mix = [](std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  };
+  std::uint64_t state = (static_cast<std::uint64_t>(fRunSeed) << 32)
+                      | static_cast<std::uint32_t>(GetEventNumber(eventID));
+  // the runs of a job get different streams, the first run keeps the
+  // seeds of the run seed and the event number
+  auto runID = GetRunID();
+  if ( runID != 0 ) state ^= mix(static_cast<std::uint64_t>(runID));
+  long seeds[3] = { 0, 0, 0 };
+  for ( G4int i = 0; i < 2; ++i ) {
+    state += 0x9e3779b97f4a7c15ULL;
+    seeds[i] = static_cast<long>(mix(state) % 2147483646ULL) + 1;
+  }
+  G4Random::setTheSeeds(seeds);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunAction::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/random/", "Random number control");
+
+  auto& runSeedCmd
+    = fMessenger->DeclareProperty("setRunSeed", fRunSeed,
+        "Set the run seed from which the seeds of each event are derived.");
+  runSeedCmd.SetParameterName("seed", false);
+  runSeedCmd.SetRange("seed>=0");
+  runSeedCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& replayCmd
+    = fMessenger->DeclareProperty("replayEvent", fReplayEventID,
+        "Re-simulate the event with the given number in the next run "
+        "(use /run/beamOn 1). -1 switches the replay off.");
+  replayCmd.SetParameterName("event", false);
+  replayCmd.SetRange("event>=-1");
+  replayCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& replayRunCmd
+    = fMessenger->DeclareProperty("replayRun", fReplayRunID,
+        "Set the ID of the run of the replayed event (RunID column of "
+        "Event_Condition).");
+  replayRunCmd.SetParameterName("run", false);
+  replayRunCmd.SetRange("run>=0");
+  replayRunCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  fOutputMessenger = new G4GenericMessenger(this, "/B4/output/", "Output control");
+
+  auto& reorderCmd
+    = fOutputMessenger->DeclareProperty("reorder", fReorderOutput,
+        "Write the ntuple rows in the event ID order (MT mode); "
+        "takes effect if given before the first run.");
+  reorderCmd.SetParameterName("reorder", true);
+  reorderCmd.SetDefaultValue("true");
+  reorderCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& windowCmd
+    = fOutputMessenger->DeclareProperty("reorderWindow", fReorderWindow,
+        "Maximum number of events waiting in the reorder buffer.");
+  windowCmd.SetParameterName("window", false);
+  windowCmd.SetRange("window>0");
+  windowCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& shardsCmd
+    = fOutputMessenger->DeclareProperty("shards", fShardOutput,
+        "Write the ntuples of each worker thread to its own file without "
+        "merging; takes effect if given before the first run.");
+  shardsCmd.SetParameterName("shards", true);
+  shardsCmd.SetDefaultValue("true");
+  shardsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& compressionCmd
+    = fOutputMessenger->DeclareProperty("compression", fCompressionLevel,
+        "Set the zlib compression level of the output file (0 = off).");
+  compressionCmd.SetParameterName("level", false);
+  compressionCmd.SetRange("level>=0 && level<=9");
+  compressionCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& basketSizeCmd
+    = fOutputMessenger->DeclareProperty("basketSize", fBasketSize,
+        "Set the basket size of the ntuple branches in bytes.");
+  basketSizeCmd.SetParameterName("bytes", false);
+  basketSizeCmd.SetRange("bytes>0");
+  basketSizeCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& basketEntriesCmd
+    = fOutputMessenger->DeclareProperty("basketEntries", fBasketEntries,
+        "Set the number of entries per basket of the ntuple branches "
+        "(a basket is written when it is full, the Geant4 ROOT writer has "
+        "no auto-flush).");
+  basketEntriesCmd.SetParameterName("entries", false);
+  basketEntriesCmd.SetRange("entries>0");
+  basketEntriesCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& directoryCmd
+    = fOutputMessenger->DeclareProperty("directory", fOutputDirectory,
+        "Set the directory of the output files (it must exist).");
+  directoryCmd.SetParameterName("directory", false);
+  directoryCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& fileNameCmd
+    = fOutputMessenger->DeclareProperty("fileName", fFileNameTemplate,
+        "Set the output file name without extension; %e is replaced by the "
+        "primary energy in GeV, %s by the run seed, %r by the run ID, "
+        "%j by the job shard index and %t by the thread number.");
+  fileNameCmd.SetParameterName("template", false);
+  fileNameCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& profileCmd
+    = fOutputMessenger->DeclareProperty("profile", fProfile,
+        "Select the trees and columns of the output; takes effect if given "
+        "before the first run.");
+  profileCmd.SetParameterName("profile", false);
+  profileCmd.SetCandidates("full cnn timing resolution");
+  profileCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // The histograms are booked in the first run
+  fHistoMessenger = new G4GenericMessenger(this, "/B4/histo/", "Histogram control");
+
+  auto& eabsMaxCmd
+    = fHistoMessenger->DeclarePropertyWithUnit("eabsMax", "GeV", fEabsMax,
+        "Set the upper edge of the Eabs histogram.");
+  eabsMaxCmd.SetParameterName("eabsMax", false);
+  eabsMaxCmd.SetRange("eabsMax>0.");
+  eabsMaxCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& egapMaxCmd
+    = fHistoMessenger->DeclarePropertyWithUnit("egapMax", "GeV", fEgapMax,
+        "Set the upper edge of the Egap histogram.");
+  egapMaxCmd.SetParameterName("egapMax", false);
+  egapMaxCmd.SetRange("egapMax>0.");
+  egapMaxCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& shapeCmd
+    = fHistoMessenger->DeclareProperty("shape", fShapeHistos,
+        "Book and fill the shower shape histograms (off by default, they "
+        "need the tile energies and the shower observables in all profiles).");
+  shapeCmd.SetParameterName("shape", true);
+  shapeCmd.SetDefaultValue("true");
+  shapeCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& nofRadiusBinsCmd
+    = fHistoMessenger->DeclareProperty("nofRadiusBins", fNofRadiusBins,
+        "Set the number of radial bins of the shower shape histograms.");
+  nofRadiusBinsCmd.SetParameterName("nofBins", false);
+  nofRadiusBinsCmd.SetRange("nofBins>0");
+  nofRadiusBinsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& radiusMaxCmd
+    = fHistoMessenger->DeclarePropertyWithUnit("radiusMax", "mm", fRadiusMax,
+        "Set the maximum radial distance from the shower axis.");
+  radiusMaxCmd.SetParameterName("radiusMax", false);
+  radiusMaxCmd.SetRange("radiusMax>0.");
+  radiusMaxCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& nofTimeBinsCmd
+    = fHistoMessenger->DeclareProperty("nofTimeBins", fNofTimeBins,
+        "Set the number of time bins of the shower shape histograms.");
+  nofTimeBinsCmd.SetParameterName("nofBins", false);
+  nofTimeBinsCmd.SetRange("nofBins>0");
+  nofTimeBinsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& timeMaxCmd
+    = fHistoMessenger->DeclarePropertyWithUnit("timeMax", "ns", fTimeMax,
+        "Set the maximum time after the arrival at the calorimeter.");
+  timeMaxCmd.SetParameterName("timeMax", false);
+  timeMaxCmd.SetRange("timeMax>0.");
+  timeMaxCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& nofEnergyBinsCmd
+    = fHistoMessenger->DeclareProperty("nofEnergyBins", fNofEnergyBins,
+        "Set the number of energy bins of the H2 shower shape histograms.");
+  nofEnergyBinsCmd.SetParameterName("nofBins", false);
+  nofEnergyBinsCmd.SetRange("nofBins>0");
+  nofEnergyBinsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& energyMaxCmd
+    = fHistoMessenger->DeclarePropertyWithUnit("energyMax", "MeV", fEnergyMax,
+        "Set the upper energy edge of the H2 shower shape histograms.");
+  energyMaxCmd.SetParameterName("energyMax", false);
+  energyMaxCmd.SetRange("energyMax>0.");
+  energyMaxCmd.SetStates(G4State_PreInit, G4State_Idle);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
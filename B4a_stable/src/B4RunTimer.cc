@@ -0,0 +1,186 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4RunTimer.cc
+/// \brief Implementation of the B4RunTimer class
+
+#include "B4RunTimer.hh"
+
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+#include <sys/resource.h>
+
+std::vector<B4RunTimer::ThreadTime> B4RunTimer::fgThreads;
+std::mutex B4RunTimer::fgMutex;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4RunTimer::B4RunTimer()
+ : fEventTime(0.),
+   fNofSteps(0.),
+   fCostSums()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4RunTimer::~B4RunTimer()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunTimer::BeginOfRun()
+{
+  fEventTime = 0.;
+  fNofSteps = 0.;
+  fCostSums = CostSums();
+  fRunStart = std::chrono::steady_clock::now();
+
+  // the master also clears the merged times of the previous run
+  if ( G4Threading::IsMasterThread() ) {
+    std::lock_guard<std::mutex> lock(fgMutex);
+    fgThreads.clear();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunTimer::Merge(G4int nofEvents)
+{
+  ThreadTime threadTime;
+  threadTime.fThreadId = G4Threading::G4GetThreadId();
+  threadTime.fNofEvents = nofEvents;
+  threadTime.fEventTime = fEventTime;
+  threadTime.fNofSteps = fNofSteps;
+  threadTime.fCost = fCostSums;
+  std::lock_guard<std::mutex> lock(fgMutex);
+  fgThreads.push_back(threadTime);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunTimer::Print(G4int nofEvents) const
+{
+  // called by the master after all workers finished the run; the idle
+  // time of a worker is the run time of the master not spent in events
+  std::chrono::duration<G4double> runTime
+    = std::chrono::steady_clock::now() - fRunStart;
+
+  std::lock_guard<std::mutex> lock(fgMutex);
+  std::sort(fgThreads.begin(), fgThreads.end(),
+    [](const ThreadTime& a, const ThreadTime& b) { return a.fThreadId < b.fThreadId; });
+
+  G4double idleTime = 0.;
+  if ( ! fgThreads.empty() ) {
+    G4cout << G4endl << " ----> event and idle time per thread" << G4endl;
+  }
+  for (const auto& threadTime : fgThreads) {
+    G4double idle = std::max(0., runTime.count() - threadTime.fEventTime/s);
+    G4cout << "  thread " << std::setw(3) << threadTime.fThreadId
+           << " : " << std::setw(8) << threadTime.fNofEvents << " events, "
+           << std::setw(10) << threadTime.fEventTime/s << " s in events, "
+           << std::setw(10) << idle << " s idle" << G4endl;
+    idleTime += idle;
+  }
+
+  G4cout << " ----> " << nofEvents << " events in " << runTime.count() << " s";
+  if ( runTime.count() > 0. ) {
+    G4cout << " (" << nofEvents/runTime.count() << " events/s)";
+  }
+  if ( ! fgThreads.empty() && runTime.count() > 0. ) {
+    G4cout << " on " << fgThreads.size() << " threads, idle "
+           << 100.*idleTime/(runTime.count()*fgThreads.size()) << " %";
+  }
+  G4cout << G4endl;
+
+  // the steps of all threads (of the master in sequential mode)
+  // and the peak resident memory of the process
+  G4double nofSteps = fNofSteps;
+  for (const auto& threadTime : fgThreads) {
+    nofSteps += threadTime.fNofSteps;
+  }
+  G4cout << " ----> " << nofSteps << " steps";
+  if ( runTime.count() > 0. ) {
+    G4cout << " (" << nofSteps/runTime.count() << " steps/s)";
+  }
+  struct rusage usage;
+  if ( getrusage(RUSAGE_SELF, &usage) == 0 ) {
+    G4cout << ", peak RSS " << usage.ru_maxrss/1024. << " MB";
+  }
+  G4cout << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4RunTimer::WriteCost(const G4String& fileName) const
+{
+  // the master adds the sums of the workers to its own (sequential mode)
+  CostSums sums = fCostSums;
+  {
+    std::lock_guard<std::mutex> lock(fgMutex);
+    for (const auto& threadTime : fgThreads) {
+      sums.fN += threadTime.fCost.fN;
+      sums.fE += threadTime.fCost.fE;
+      sums.fE2 += threadTime.fCost.fE2;
+      sums.fT += threadTime.fCost.fT;
+      sums.fET += threadTime.fCost.fET;
+      sums.fT2 += threadTime.fCost.fT2;
+    }
+  }
+  if ( sums.fN < 1. || sums.fE <= 0. ) return;
+
+  // cost = a + b*E; with a single energy the cost is taken as
+  // proportional to the energy
+  G4double a = 0.;
+  G4double b = sums.fT/sums.fE;
+  G4double denominator = sums.fN*sums.fE2 - sums.fE*sums.fE;
+  if ( denominator > 1e-6*sums.fN*sums.fE2 ) {
+    b = (sums.fN*sums.fET - sums.fE*sums.fT)/denominator;
+    a = (sums.fT - b*sums.fE)/sums.fN;
+  }
+  G4double residual2 = ( sums.fT2 - 2.*a*sums.fT - 2.*b*sums.fET
+                       + a*a*sums.fN + 2.*a*b*sums.fE + b*b*sums.fE2 )/sums.fN;
+  G4double rms = std::sqrt(std::max(0., residual2));
+
+  G4cout << " ----> event cost: " << a << " s + " << b << " s/GeV * E"
+         << " (rms " << rms << " s, " << sums.fN << " events)" << G4endl;
+
+  // the sums allow planSweep.sh to fit the runs of several energies
+  G4String costName = fileName;
+  costName.replace(costName.size() - 5, 5, ".cost");
+  std::ofstream cost(costName);
+  cost << "# events sumE sumE2 sumT sumET sumT2 a[s] b[s/GeV] rms[s]"
+       << std::endl;
+  cost << sums.fN << " " << sums.fE << " " << sums.fE2 << " " << sums.fT
+       << " " << sums.fET << " " << sums.fT2 << " " << a << " " << b
+       << " " << rms << std::endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,193 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4SiPMDigitizer.cc
+/// \brief Implementation of the B4SiPMDigitizer class
+
+#include "B4SiPMDigitizer.hh"
+#include "B4DetectorConstruction.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4Poisson.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4SiPMDigitizer::B4SiPMDigitizer(const B4DetectorConstruction* detConstruction)
+ : fDetConstruction(detConstruction),
+   fMessenger(nullptr),
+   fEnabled(false),
+   fMipdEdx(2.0*MeV/cm), // minimum ionization in polyvinyltoluene
+   fMipEnergy(0.),
+   fBirksConstant(0.126*mm/MeV),
+   fLightYield(15.),
+   fNofPixels(1600.),
+   fPhotostatistics(true),
+   fNoise(0.),
+   fThreshold(0.5)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4SiPMDigitizer::~B4SiPMDigitizer()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double B4SiPMDigitizer::GetMipEnergy() const
+{
+  if ( fMipEnergy > 0. ) return fMipEnergy;
+  return fMipdEdx*fDetConstruction->fHGapThickness;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4SiPMDigitizer::Digitize(const std::vector<G4double>& visibleEnergy,
+                               std::vector<G4double>& amplitude) const
+{
+  auto nofTiles = visibleEnergy.size();
+  amplitude.resize(nofTiles);
+  const G4double* energy = visibleEnergy.data();
+  G4double* signal = amplitude.data();
+
+  // calibration and pixel saturation (branch free, vectorized)
+  const G4double toPhotoelectrons = fLightYield/GetMipEnergy();
+  if ( fNofPixels > 0. ) {
+    const G4double nofPixels = fNofPixels;
+    const G4double toOccupancy = toPhotoelectrons/fNofPixels;
+    for (std::size_t i = 0; i < nofTiles; ++i) {
+      signal[i] = nofPixels*(1. - std::exp(-energy[i]*toOccupancy));
+    }
+  }
+  else {
+    for (std::size_t i = 0; i < nofTiles; ++i) {
+      signal[i] = energy[i]*toPhotoelectrons;
+    }
+  }
+
+  // photostatistics and noise (one random number per tile and effect)
+  if ( fPhotostatistics ) {
+    for (std::size_t i = 0; i < nofTiles; ++i) {
+      signal[i] = G4Poisson(signal[i]);
+    }
+  }
+  if ( fNoise > 0. ) {
+    for (std::size_t i = 0; i < nofTiles; ++i) {
+      signal[i] += G4RandGauss::shoot(0., fNoise);
+    }
+  }
+
+  // conversion to MIP and zero suppression (branch free, vectorized)
+  const G4double toMip = 1./fLightYield;
+  const G4double threshold = fThreshold;
+  for (std::size_t i = 0; i < nofTiles; ++i) {
+    const G4double mip = signal[i]*toMip;
+    signal[i] = ( mip >= threshold ) ? mip : 0.;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4SiPMDigitizer::DefineCommands()
+{
+  fMessenger
+    = new G4GenericMessenger(this, "/B4/digi/", "SiPM digitization control");
+
+  auto& enableCmd
+    = fMessenger->DeclareProperty("enable", fEnabled,
+        "Write the digitized tile amplitudes in the Digi ntuple; "
+        "takes effect if given before the first run.");
+  enableCmd.SetParameterName("enable", true);
+  enableCmd.SetDefaultValue("true");
+  enableCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& mipdEdxCmd
+    = fMessenger->DeclarePropertyWithUnit("mipdEdx", "MeV/cm", fMipdEdx,
+        "Set the MIP energy loss per unit length in the tiles.");
+  mipdEdxCmd.SetParameterName("dEdx", false);
+  mipdEdxCmd.SetRange("dEdx>0.");
+  mipdEdxCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& mipCmd
+    = fMessenger->DeclarePropertyWithUnit("mipEnergy", "MeV", fMipEnergy,
+        "Set the MIP energy in a tile (0 = mipdEdx times the tile thickness).");
+  mipCmd.SetParameterName("energy", false);
+  mipCmd.SetRange("energy>=0.");
+  mipCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // (mm/MeV are the internal units, no unit conversion is needed)
+  auto& birksCmd
+    = fMessenger->DeclareProperty("birks", fBirksConstant,
+        "Set the Birks constant of the scintillator in mm/MeV "
+        "(0 = no quenching).");
+  birksCmd.SetParameterName("kB", false);
+  birksCmd.SetRange("kB>=0.");
+  birksCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& lightYieldCmd
+    = fMessenger->DeclareProperty("lightYield", fLightYield,
+        "Set the number of photoelectrons per MIP.");
+  lightYieldCmd.SetParameterName("yield", false);
+  lightYieldCmd.SetRange("yield>0.");
+  lightYieldCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& pixelsCmd
+    = fMessenger->DeclareProperty("nofPixels", fNofPixels,
+        "Set the number of SiPM pixels (0 = no saturation).");
+  pixelsCmd.SetParameterName("pixels", false);
+  pixelsCmd.SetRange("pixels>=0.");
+  pixelsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& photostatisticsCmd
+    = fMessenger->DeclareProperty("photostatistics", fPhotostatistics,
+        "Smear the number of photoelectrons with the Poisson statistics.");
+  photostatisticsCmd.SetParameterName("photostatistics", true);
+  photostatisticsCmd.SetDefaultValue("true");
+  photostatisticsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& noiseCmd
+    = fMessenger->DeclareProperty("noise", fNoise,
+        "Set the Gaussian noise of the fired tiles in photoelectrons.");
+  noiseCmd.SetParameterName("noise", false);
+  noiseCmd.SetRange("noise>=0.");
+  noiseCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& thresholdCmd
+    = fMessenger->DeclareProperty("threshold", fThreshold,
+        "Set the threshold of the digitized amplitudes in MIP.");
+  thresholdCmd.SetParameterName("threshold", false);
+  thresholdCmd.SetRange("threshold>=0.");
+  thresholdCmd.SetStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,203 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4StepProfiler.cc
+/// \brief Implementation of the B4StepProfiler class
+
+#include "B4StepProfiler.hh"
+
+#include "G4Step.hh"
+#include "G4LogicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4VProcess.hh"
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+std::map<B4StepProfiler::NameKey, B4StepProfiler::Counter>
+  B4StepProfiler::fgCounters;
+std::mutex B4StepProfiler::fgMutex;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepProfiler::B4StepProfiler()
+ : fMessenger(nullptr),
+   fEnabled(false),
+   fNofPrintedRows(20)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepProfiler::~B4StepProfiler()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepProfiler::Record(const G4Step* step)
+{
+  auto now = std::chrono::steady_clock::now();
+  auto track = step->GetTrack();
+
+  Key key;
+  key.fVolume = step->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume();
+  key.fParticle = track->GetDefinition();
+  key.fProcess = step->GetPostStepPoint()->GetProcessDefinedStep();
+
+  auto& counter = fCounters[key];
+  counter.fNofSteps += 1.;
+  counter.fEdep += step->GetTotalEnergyDeposit();
+
+  // the first step of an event follows the end of the previous event
+  if ( track->GetTrackID() != 1 || track->GetCurrentStepNumber() != 1 ) {
+    std::chrono::duration<G4double> time = now - fLastStep;
+    counter.fTime += time.count()*s;
+  }
+  fLastStep = now;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepProfiler::Clear()
+{
+  fCounters.clear();
+
+  // the master also clears the merged counters of the previous run
+  if ( G4Threading::IsMasterThread() ) {
+    std::lock_guard<std::mutex> lock(fgMutex);
+    fgCounters.clear();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepProfiler::Merge()
+{
+  std::lock_guard<std::mutex> lock(fgMutex);
+  for (const auto& entry : fCounters) {
+    const auto& key = entry.first;
+    NameKey name(key.fVolume->GetName(), key.fParticle->GetPDGEncoding(),
+                 key.fParticle->GetParticleName(),
+                 key.fProcess ? key.fProcess->GetProcessName() : "none");
+    auto& counter = fgCounters[name];
+    counter.fNofSteps += entry.second.fNofSteps;
+    counter.fTime += entry.second.fTime;
+    counter.fEdep += entry.second.fEdep;
+  }
+  fCounters.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepProfiler::Write(const G4String& fileName) const
+{
+  // called by the master after the counters of all threads were merged
+  std::lock_guard<std::mutex> lock(fgMutex);
+  if ( fgCounters.empty() ) return;
+
+  std::vector<std::pair<NameKey, Counter>> rows(fgCounters.begin(),
+                                                fgCounters.end());
+  std::sort(rows.begin(), rows.end(),
+    [](const std::pair<NameKey, Counter>& a, const std::pair<NameKey, Counter>& b)
+    { return a.second.fTime > b.second.fTime; });
+
+  Counter total = { 0., 0., 0. };
+  for (const auto& row : rows) {
+    total.fNofSteps += row.second.fNofSteps;
+    total.fTime += row.second.fTime;
+    total.fEdep += row.second.fEdep;
+  }
+
+  G4cout << G4endl << " ----> steps per volume, particle and process ("
+         << total.fNofSteps << " steps, " << total.fTime/s << " s)" << G4endl;
+  G4int nofRows = std::min(static_cast<G4int>(rows.size()), fNofPrintedRows);
+  auto flags = G4cout.flags();
+  auto precision = G4cout.precision();
+  for (G4int i = 0; i < nofRows; ++i) {
+    const auto& name = rows[i].first;
+    const auto& counter = rows[i].second;
+    G4cout << "  " << std::setw(12) << std::get<0>(name)
+           << " " << std::setw(12) << std::get<2>(name)
+           << " " << std::setw(16) << std::get<3>(name)
+           << " : " << std::setw(12) << counter.fNofSteps << " steps "
+           << std::setw(6) << std::fixed << std::setprecision(2)
+           << 100.*counter.fNofSteps/total.fNofSteps << " %, "
+           << std::setw(10) << std::setprecision(3) << counter.fTime/s << " s "
+           << std::setw(6) << std::setprecision(2)
+           << ( total.fTime > 0. ? 100.*counter.fTime/total.fTime : 0. )
+           << " %, " << std::setw(10) << std::setprecision(1)
+           << counter.fEdep/MeV << " MeV" << G4endl;
+  }
+  G4cout.flags(flags);
+  G4cout.precision(precision);
+
+  // full table, read by plotSteps.C
+  G4String tableName = fileName;
+  tableName.replace(tableName.size() - 5, 5, ".steps");
+  std::ofstream table(tableName);
+  table << "# volume pdg particle process steps time[s] edep[MeV]" << std::endl;
+  for (const auto& row : rows) {
+    const auto& name = row.first;
+    table << std::get<0>(name) << " " << std::get<1>(name) << " "
+          << std::get<2>(name) << " " << std::get<3>(name) << " "
+          << row.second.fNofSteps << " " << row.second.fTime/s << " "
+          << row.second.fEdep/MeV << std::endl;
+  }
+  G4cout << "  " << rows.size() << " rows written in " << tableName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepProfiler::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/profile/", "Step profiling");
+
+  auto& stepsCmd
+    = fMessenger->DeclareProperty("steps", fEnabled,
+        "Count the steps, their time and energy deposit per volume, "
+        "particle and process.");
+  stepsCmd.SetParameterName("steps", true);
+  stepsCmd.SetDefaultValue("true");
+  stepsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& nofRowsCmd
+    = fMessenger->DeclareProperty("nofPrintedRows", fNofPrintedRows,
+        "Set the number of rows of the step profile printed at the end "
+        "of run (all rows are written in the table).");
+  nofRowsCmd.SetParameterName("nofRows", false);
+  nofRowsCmd.SetRange("nofRows>=0");
+  nofRowsCmd.SetStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
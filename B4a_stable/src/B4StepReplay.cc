@@ -0,0 +1,152 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4StepReplay.cc
+/// \brief Implementation of the B4StepReplay class
+
+#include "B4StepReplay.hh"
+#include "B4RunAction.hh"
+#include "B4aEventAction.hh"
+#include "B4aSteppingAction.hh"
+
+#include "G4Run.hh"
+#include "G4Event.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <chrono>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepReplay::B4StepReplay(B4RunAction* runAction,
+                           B4aEventAction* eventAction,
+                           B4aSteppingAction* steppingAction)
+ : fRunAction(runAction),
+   fEventAction(eventAction),
+   fSteppingAction(steppingAction),
+   fRunID(0),
+   fNofEvents(0),
+   fNofSteps(0.),
+   fBeginTime(0.),
+   fStepTime(0.),
+   fEndTime(0.)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepReplay::~B4StepReplay()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int B4StepReplay::ReadStream(const G4String& fileName)
+{
+  B4StepStreamReader reader(fileName);
+  G4int nofEvents = 0;
+  StreamEvent event;
+  while ( reader.ReadEvent(event.fHeader, event.fSteps) ) {
+    fEvents.push_back(event);
+    ++nofEvents;
+  }
+  G4cout << fileName << ": " << nofEvents << " events" << G4endl;
+  return nofEvents;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepReplay::Replay(G4int nofRepetitions)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  G4Run run;
+  run.SetRunID(fRunID++);
+  fRunAction->BeginOfRunAction(&run);
+
+  for (G4int repetition = 0; repetition < nofRepetitions; ++repetition) {
+    for (const auto& streamEvent : fEvents) {
+      const auto& header = streamEvent.fHeader;
+      // the recorded event number (with /B4/job/eventOffset 0)
+      G4Event event(header.fEventID);
+
+      auto start = Clock::now();
+      fEventAction->BeginOfEventAction(&event);
+
+      auto steps = Clock::now();
+      for (G4int i = 0; i < header.fNofTracks; ++i) {
+        fEventAction->CountTrack();
+      }
+      const auto& point = header.fGenerationPoint;
+      const auto& momentum = header.fMomentum;
+      fEventAction->AddCondition(point.x(), point.y(), point.z(), header.fEnergy,
+                                 momentum.x(), momentum.y(), momentum.z());
+      for (const auto& step : streamEvent.fSteps) {
+        fSteppingAction->ProcessStep(step);
+      }
+      const auto& vertex = header.fVertex;
+      fEventAction->AddVertex(vertex.x(), vertex.y(), vertex.z());
+
+      auto end = Clock::now();
+      fEventAction->EndOfEventAction(&event);
+      auto stop = Clock::now();
+
+      run.RecordEvent(&event);
+      std::chrono::duration<G4double> beginTime = steps - start;
+      std::chrono::duration<G4double> stepTime = end - steps;
+      std::chrono::duration<G4double> endTime = stop - end;
+      fBeginTime += beginTime.count()*s;
+      fStepTime += stepTime.count()*s;
+      fEndTime += endTime.count()*s;
+      fNofSteps += streamEvent.fSteps.size();
+      ++fNofEvents;
+    }
+  }
+
+  fRunAction->EndOfRunAction(&run);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepReplay::PrintTimes() const
+{
+  if ( fNofEvents == 0 ) return;
+
+  G4double totalTime = fBeginTime + fStepTime + fEndTime;
+  G4cout << G4endl << " ----> " << fNofEvents << " events (" << fNofSteps
+         << " steps) replayed in " << totalTime/s << " s" << G4endl
+         << "  begin of event : " << fBeginTime/fNofEvents/microsecond
+         << " us/event" << G4endl
+         << "  steps          : " << fStepTime/fNofEvents/microsecond
+         << " us/event, "
+         << ( fNofSteps > 0. ? fStepTime/fNofSteps/ns : 0. ) << " ns/step"
+         << G4endl
+         << "  end of event   : " << fEndTime/fNofEvents/microsecond
+         << " us/event" << G4endl;
+  if ( totalTime > 0. ) {
+    G4cout << "  total          : " << fNofEvents/(totalTime/s)
+           << " events/s" << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
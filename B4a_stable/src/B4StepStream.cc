@@ -0,0 +1,265 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+// 
+/// \file B4StepStream.cc
+/// \brief Implementation of the B4StepStreamWriter and B4StepStreamReader classes
+
+#include "B4StepStream.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+// file signature and format version of the step stream
+const char streamMagic[4] = { 'B', '4', 'S', 'S' };
+const std::uint32_t streamVersion = 2;
+
+// the event header as written in the file
+struct PackedHeader {
+  std::int32_t fEventID;
+  std::uint32_t fNofSteps;
+  std::uint32_t fNofTracks;
+  float fGenerationPoint[3];
+  float fEnergy;
+  float fMomentum[3];
+  float fVertex[3];
+};
+
+// the lengths in mm, the energies and momenta in MeV, the time in ns
+void Pack(const G4ThreeVector& vector, G4double unit, float* values) {
+  values[0] = vector.x()/unit;
+  values[1] = vector.y()/unit;
+  values[2] = vector.z()/unit;
+}
+
+G4ThreeVector Unpack(const float* values, G4double unit) {
+  return G4ThreeVector(values[0]*unit, values[1]*unit, values[2]*unit);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepStreamWriter::B4StepStreamWriter()
+ : fMessenger(nullptr),
+   fCapture(false),
+   fFileName("B4"),
+   fOpenFileName(""),
+   fNofEvents(0)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepStreamWriter::~B4StepStreamWriter()
+{
+  Close();
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepStreamWriter::AddStep(const B4StepRecord& step)
+{
+  PackedStep packed;
+  packed.fVolume = step.fVolume;
+  packed.fFlags = step.fFlags;
+  packed.fReplicaNo = step.fReplicaNo;
+  packed.fCopyNo = step.fCopyNo;
+  packed.fParticle = step.fParticle;
+  packed.fTrackID = step.fTrackID;
+  packed.fParentID = step.fParentID;
+  packed.fEdep = step.fEdep/MeV;
+  packed.fStepLength = step.fStepLength/mm;
+  packed.fTime = step.fTime/ns;
+  Pack(step.fPrePosition, mm, packed.fPrePosition);
+  Pack(step.fPostPosition, mm, packed.fPostPosition);
+  Pack(step.fPostMomentum, MeV, packed.fPostMomentum);
+  packed.fPostEnergy = step.fPostEnergy/MeV;
+  fSteps.push_back(packed);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepStreamWriter::WriteEvent(B4StepEventHeader& header)
+{
+  // the file of the thread is opened with its first event
+  if ( ! fFile.is_open() ) {
+    std::ostringstream fileName;
+    fileName << fFileName;
+    if ( G4Threading::IsWorkerThread() ) {
+      fileName << "_t" << G4Threading::G4GetThreadId();
+    }
+    fileName << ".b4s";
+    fFile.open(fileName.str(), std::ios::binary | std::ios::trunc);
+    if ( ! fFile ) {
+      G4ExceptionDescription msg;
+      msg << "Cannot open " << fileName.str() << ", the steps are not written.";
+      G4Exception("B4StepStreamWriter::WriteEvent()", "B4Stream0001",
+        JustWarning, msg);
+      fCapture = false;
+      fSteps.clear();
+      return;
+    }
+    fFile.write(streamMagic, sizeof(streamMagic));
+    fFile.write(reinterpret_cast<const char*>(&streamVersion),
+                sizeof(streamVersion));
+    fOpenFileName = fileName.str();
+    fNofEvents = 0;
+  }
+
+  header.fNofSteps = fSteps.size();
+  PackedHeader packed;
+  packed.fEventID = header.fEventID;
+  packed.fNofSteps = header.fNofSteps;
+  packed.fNofTracks = header.fNofTracks;
+  Pack(header.fGenerationPoint, mm, packed.fGenerationPoint);
+  packed.fEnergy = header.fEnergy/MeV;
+  Pack(header.fMomentum, MeV, packed.fMomentum);
+  Pack(header.fVertex, mm, packed.fVertex);
+
+  fFile.write(reinterpret_cast<const char*>(&packed), sizeof(packed));
+  fFile.write(reinterpret_cast<const char*>(fSteps.data()),
+              fSteps.size()*sizeof(PackedStep));
+  fSteps.clear();
+  ++fNofEvents;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepStreamWriter::Close()
+{
+  fSteps.clear();
+  if ( ! fFile.is_open() ) return;
+
+  fFile.close();
+  G4cout << " ----> " << fNofEvents << " events written in the step stream "
+         << fOpenFileName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4StepStreamWriter::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/stream/", "Step stream control");
+
+  auto& captureCmd
+    = fMessenger->DeclareProperty("capture", fCapture,
+        "Write the steps of the events in the step stream file.");
+  captureCmd.SetParameterName("capture", true);
+  captureCmd.SetDefaultValue("true");
+  captureCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& fileNameCmd
+    = fMessenger->DeclareProperty("fileName", fFileName,
+        "Set the step stream file name without extension; the worker "
+        "threads add the suffix _t<thread number>.");
+  fileNameCmd.SetParameterName("fileName", false);
+  fileNameCmd.SetStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepStreamReader::B4StepStreamReader(const G4String& fileName)
+ : fFile(fileName, std::ios::binary),
+   fGood(false)
+{
+  char magic[sizeof(streamMagic)];
+  std::uint32_t version = 0;
+  fFile.read(magic, sizeof(magic));
+  fFile.read(reinterpret_cast<char*>(&version), sizeof(version));
+  fGood = fFile.good() && std::memcmp(magic, streamMagic, sizeof(magic)) == 0
+          && version == streamVersion;
+
+  if ( ! fGood ) {
+    G4ExceptionDescription msg;
+    msg << fileName << " is not a step stream of version " << streamVersion;
+    G4Exception("B4StepStreamReader::B4StepStreamReader()", "B4Stream0002",
+      JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4StepStreamReader::~B4StepStreamReader()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool B4StepStreamReader::ReadEvent(B4StepEventHeader& header,
+                                     std::vector<B4StepRecord>& steps)
+{
+  if ( ! fGood ) return false;
+
+  PackedHeader packed;
+  fFile.read(reinterpret_cast<char*>(&packed), sizeof(packed));
+  if ( ! fFile ) {
+    fGood = false;
+    return false;
+  }
+  fSteps.resize(packed.fNofSteps);
+  fFile.read(reinterpret_cast<char*>(fSteps.data()),
+             fSteps.size()*sizeof(B4StepStreamWriter::PackedStep));
+  fGood = fFile.good();
+  if ( ! fGood ) return false;
+
+  header.fEventID = packed.fEventID;
+  header.fNofSteps = packed.fNofSteps;
+  header.fNofTracks = packed.fNofTracks;
+  header.fGenerationPoint = Unpack(packed.fGenerationPoint, mm);
+  header.fEnergy = packed.fEnergy*MeV;
+  header.fMomentum = Unpack(packed.fMomentum, MeV);
+  header.fVertex = Unpack(packed.fVertex, mm);
+
+  steps.resize(fSteps.size());
+  for (std::size_t i = 0; i < fSteps.size(); ++i) {
+    const auto& packedStep = fSteps[i];
+    auto& step = steps[i];
+    step.fVolume = packedStep.fVolume;
+    step.fFlags = packedStep.fFlags;
+    step.fReplicaNo = packedStep.fReplicaNo;
+    step.fCopyNo = packedStep.fCopyNo;
+    step.fParticle = packedStep.fParticle;
+    step.fTrackID = packedStep.fTrackID;
+    step.fParentID = packedStep.fParentID;
+    step.fEdep = packedStep.fEdep*MeV;
+    step.fStepLength = packedStep.fStepLength*mm;
+    step.fTime = packedStep.fTime*ns;
+    step.fPrePosition = Unpack(packedStep.fPrePosition, mm);
+    step.fPostPosition = Unpack(packedStep.fPostPosition, mm);
+    step.fPostMomentum = Unpack(packedStep.fPostMomentum, MeV);
+    step.fPostEnergy = packedStep.fPostEnergy*MeV;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -29,55 +29,179 @@
 
 #include "B4aEventAction.hh"
 #include "B4RunAction.hh"
+#include "B4RunTimer.hh"
 #include "B4Analysis.hh"
+#include "B4EventRecord.hh"
+#include "B4StepStream.hh"
+#include "B4MemoryMonitor.hh"
 
 #include "G4RunManager.hh"
 #include "G4Event.hh"
+#include "G4GenericMessenger.hh"
 #include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
 
 #include "Randomize.hh"
+#include <algorithm>
 #include <iomanip>
+#include <time.h>
 
 #include <vector>
 
+namespace {
+  // CPU time of the calling thread (std::clock() counts all threads)
+  G4double GetThreadCpuTime() {
+    timespec cpuTime;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuTime);
+    return cpuTime.tv_sec*s + cpuTime.tv_nsec*ns;
+  }
+
+  // allocated bytes of a per-event buffer
+  template <typename T>
+  std::size_t CapacityBytes(const std::vector<T>& buffer) {
+    return buffer.capacity()*sizeof(T);
+  }
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-B4aEventAction::B4aEventAction(B4DetectorConstruction* detConstruction)
+B4aEventAction::B4aEventAction(B4DetectorConstruction* detConstruction,
+                               const B4RunAction* runAction)
  : G4UserEventAction(),
-   fDetConstruction(detConstruction),
    fEnergyAbs(0.),
    fEnergyGap(0.),
    fTrackLAbs(0.),
-   fTrackLGap(0.)
-{}
+   fTrackLGap(0.),
+   fDetConstruction(detConstruction),
+   fRunAction(runAction),
+   fCollectTiles(true),
+   fCollectTimes(true),
+   fDigitize(false),
+   fDigitizer(runAction->GetDigitizer()),
+   fMemoryMonitor(runAction->GetMemoryMonitor()),
+   fMessenger(nullptr),
+   fTimeBinWidth(0.),
+   fThreshold(0.),
+   fThresholdMip(0.),
+   fTileThreshold(0.),
+   fEnergyBelow(0.),
+   fTimeWindow(0.),
+   fTimeWindowStart(0.),
+   fDropOutOfWindow(false),
+   fArrivalTime(-1.),
+   fCollectShower(false),
+   fTileX0(0.),
+   fTileY0(0.),
+   fTileSize(0.),
+   fLayerZ0(0.),
+   fLayerThickness(0.),
+   fShowerE(0.),
+   fShowerEX(0.),
+   fShowerEY(0.),
+   fShowerEZ(0.),
+   fShowerEX2(0.),
+   fShowerEY2(0.),
+   fShowerEZ2(0.),
+   fCollectShape(false),
+   fShapeTimeBinWidth(0.),
+   fEventCpuStart(0.),
+   fNofSteps(0),
+   fNofTracks(0)
+{
+  // the tiles are reset after each event in BeginOfEventAction()
+  for (G4int l=0; l<48; ++l) {
+    for (G4int ix=0; ix<100; ++ix) {
+      for (G4int iy=0; iy<100; ++iy) {
+        fEnergyGapbyLyr[l][ix][iy] = 0.;
+      }
+    }
+  }
+
+  DefineCommands();
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 B4aEventAction::~B4aEventAction()
-{}
+{
+  delete fMessenger;
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void B4aEventAction::BeginOfEventAction(const G4Event* /*event*/)
 {  
+  if ( fMemoryMonitor->IsEnabled() ) fMemoryMonitor->BeginEvent();
+  fEventStart = std::chrono::steady_clock::now();
+  fEventCpuStart = GetThreadCpuTime();
+  fNofSteps = 0;
+  fNofTracks = 0;
+
   // initialisation per event
   fEnergyAbs = 0.;
   fEnergyGap = 0.;
   fTrackLAbs = 0.;
   fTrackLGap = 0.;
+
+  // collect only what is written in the output profile
+  fDigitize = fRunAction->IsNtupleActive(B4RunAction::kDigiNtuple);
+  fCollectTimes = fRunAction->IsNtupleActive(B4RunAction::kGapEdepNtuple);
+  fTileThreshold = ( fThresholdMip > 0. )
+    ? fThresholdMip*fDigitizer->GetMipEnergy() : fThreshold;
+  fCollectShape = fRunAction->IsShapeActive();
+  fCollectShower
+    = fRunAction->IsNtupleActive(B4RunAction::kShowerNtuple) || fCollectShape;
+  fCollectTiles
+    = fRunAction->IsNtupleActive(B4RunAction::kEdepNtuple) || fDigitize ||
+      fCollectShower || ( fCollectTimes && fTileThreshold > 0. );
+  if (fCollectShape) {
+    fShapeTimeBinWidth = fRunAction->GetTimeMax()/fRunAction->GetNofTimeBins();
+    fEnergybyTime.assign(fRunAction->GetNofTimeBins(), 0.);
+    fEnergybyRadius.assign(fRunAction->GetNofRadiusBins(), 0.);
+  }
+
   for (G4int l=0; l<48; ++l) {
     fEnergyAbsbyLyr[l] = 0.;
-    for (G4int ix=0; ix<100; ++ix) {
-      for (G4int iy=0; iy<100; ++iy) {
-        fEnergyGapbyLyr[l][ix][iy] = 0.;
-      }
-    }
+    fShowerEnergybyLyr[l] = 0.;
   }
 
-  vertextime = 0;
+  // shower moments; the positions are taken at the tile and layer centres,
+  // z from the front face of the calorimeter
+  fShowerE = 0.;
+  fShowerEX = 0.;
+  fShowerEY = 0.;
+  fShowerEZ = 0.;
+  fShowerEX2 = 0.;
+  fShowerEY2 = 0.;
+  fShowerEZ2 = 0.;
+  fTileSize = fDetConstruction->fHTileSize;
+  fTileX0 = (0.5 - fDetConstruction->fNModuleX*9*0.5)*fTileSize;
+  fTileY0 = (0.5 - fDetConstruction->fNModuleY*9*0.5)*fTileSize;
+  fLayerThickness = fDetConstruction->fHLayerThickness;
+  fLayerZ0 = 0.5*fLayerThickness;
+
+  // reset only the tiles fired in the previous event
+  auto energyGap = &fEnergyGapbyLyr[0][0][0];
+  for (auto tile : fFiredTiles) {
+    energyGap[tile] = 0.;
+    if (! fVisibleGap.empty()) fVisibleGap[tile] = 0.;
+    if (! fEnergyGapOut.empty()) fEnergyGapOut[tile] = 0.;
+  }
+  fFiredTiles.clear();
+
+  // the tile arrays of the digitization and the time window
+  // are allocated when they are first used
+  if (fDigitize && fVisibleGap.empty()) fVisibleGap.resize(48*100*100, 0.);
+  if (fTimeWindow > 0. && fEnergyGapOut.empty()) fEnergyGapOut.resize(48*100*100, 0.);
+  fArrivalTime = -1.;
+
   fParticleNumber = 1;
 
-  EventInitialInfo = 0;
+  fStartProcess = -1;
+  fStartLayer = -1;
+  fStartPointX = 0.;
+  fStartPointY = 0.;
+  fStartPointZ = 0.;
 
   //vector initialization
   fDetectLayer.clear();
@@ -86,6 +210,8 @@ void B4aEventAction::BeginOfEventAction(const G4Event* /*event*/)
   fDetectEnergy.clear();
   fDetectTime.clear();
   fDetectPartileID.clear();
+  fDetectNofSteps.clear();
+  fHitIndex.clear();
 
   fDetectLayer.shrink_to_fit();
   fDetectTileX.shrink_to_fit();
@@ -93,13 +219,24 @@ void B4aEventAction::BeginOfEventAction(const G4Event* /*event*/)
   fDetectEnergy.shrink_to_fit();
   fDetectTime.shrink_to_fit();
   fDetectPartileID.shrink_to_fit();
+  fDetectNofSteps.shrink_to_fit();
 
   fIncidentPointX.clear();
   fIncidentPointY.clear();
+  fIncidentPointZ.clear();
+  fIncidentMomentumX.clear();
+  fIncidentMomentumY.clear();
+  fIncidentMomentumZ.clear();
+  fIncidentEnergy.clear();
   fIncidentID.clear();
 
   fIncidentPointX.shrink_to_fit();
   fIncidentPointY.shrink_to_fit();
+  fIncidentPointZ.shrink_to_fit();
+  fIncidentMomentumX.shrink_to_fit();
+  fIncidentMomentumY.shrink_to_fit();
+  fIncidentMomentumZ.shrink_to_fit();
+  fIncidentEnergy.shrink_to_fit();
   fIncidentID.shrink_to_fit();
 }
 
@@ -107,8 +244,27 @@ void B4aEventAction::BeginOfEventAction(const G4Event* /*event*/)
 
 void B4aEventAction::EndOfEventAction(const G4Event* event)
 {
-  G4int nofModuleX = fDetConstruction->fNModuleX;
-  G4int nofModuleY = fDetConstruction->fNModuleY;
+  // cost of the event (without the output)
+  std::chrono::duration<G4double> wallTime
+    = std::chrono::steady_clock::now() - fEventStart;
+  G4double cpuTime = GetThreadCpuTime() - fEventCpuStart;
+  fRunAction->GetRunTimer()->AddEventCost(fInitialEnergy, cpuTime);
+
+  // write the steps of the event in the step stream
+  auto stepStream = fRunAction->GetStepStream();
+  if (stepStream->IsCapturing()) {
+    B4StepEventHeader header;
+    header.fEventID = fRunAction->GetEventNumber(event->GetEventID());
+    header.fNofSteps = 0;
+    header.fNofTracks = fNofTracks;
+    header.fGenerationPoint
+      = G4ThreeVector(fGenerationPointX, fGenerationPointY, fGenerationPointZ);
+    header.fEnergy = fInitialEnergy;
+    header.fMomentum = G4ThreeVector(fMomentumX, fMomentumY, fMomentumZ);
+    header.fVertex = G4ThreeVector(fVertexX, fVertexY, fVertexZ);
+    stepStream->WriteEvent(header);
+  }
+
   // Accumulate statistics
   //
 
@@ -121,96 +277,195 @@ void B4aEventAction::EndOfEventAction(const G4Event* event)
   analysisManager->FillH1(2, fTrackLAbs);
   analysisManager->FillH1(3, fTrackLGap);
 
-  auto eventID = event->GetEventID();
+  // event number (the replayed event number in the replay mode)
+  auto eventID = fRunAction->GetEventNumber(event->GetEventID());
+
+  // collect the ntuple rows of this event
+  fRecord.Reset(event->GetEventID(), fRunAction->GetNofNtuples());
+
+  // energy of the tiles below the threshold
+  std::sort(fFiredTiles.begin(), fFiredTiles.end());
+  auto energyGap = &fEnergyGapbyLyr[0][0][0];
+  fEnergyBelow = 0.;
+  if (fTileThreshold > 0.) {
+    for (auto tile : fFiredTiles) {
+      if (energyGap[tile] < fTileThreshold) fEnergyBelow += energyGap[tile];
+    }
+  }
+
+  // energy of the tiles outside the time window
+  G4double energyOut = 0.;
+  if (fTimeWindow > 0.) {
+    for (auto tile : fFiredTiles) {
+      energyOut += fEnergyGapOut[tile];
+    }
+  }
 
   // fill ntuple  
-  analysisManager->FillNtupleDColumn(0, 0, fEnergyAbs);
-  analysisManager->FillNtupleDColumn(0, 1, fEnergyGap);
-  analysisManager->FillNtupleDColumn(0, 2, fTrackLAbs);
-  analysisManager->FillNtupleDColumn(0, 3, fTrackLGap);
-  analysisManager->FillNtupleDColumn(0, 4, eventID);
-  analysisManager->AddNtupleRow(0);  
+  if (fRunAction->IsNtupleActive(B4RunAction::kEventNtuple)) {
+    fRecord.AddRow(B4RunAction::kEventNtuple,
+                   fEnergyAbs, fEnergyGap, fTrackLAbs, fTrackLGap, eventID,
+                   fEnergyBelow, energyOut, wallTime.count(), cpuTime/s,
+                   fNofSteps, fNofTracks);
+  }
   
-  // fill ntuple2
-  for (G4int l = 0; l < 48; l++) {
-    if (fEnergyAbsbyLyr[l] != 0) {
-      analysisManager->FillNtupleDColumn(1, 0, eventID);
-      analysisManager->FillNtupleDColumn(1, 1, l);
-      analysisManager->FillNtupleDColumn(1, 2, 0);
-      analysisManager->FillNtupleDColumn(1, 3, 0);
-      analysisManager->FillNtupleDColumn(1, 4, 0);
-      analysisManager->FillNtupleDColumn(1, 5, fEnergyAbsbyLyr[l]);
-      analysisManager->AddNtupleRow(1);
+  // shower observables
+  if (fRunAction->IsNtupleActive(B4RunAction::kShowerNtuple)) {
+    G4int nofHits = 0;
+    for (auto tile : fFiredTiles) {
+      if (energyGap[tile] > 0. && energyGap[tile] >= fTileThreshold) nofHits++;
+    }
+    G4double cog[3] = { 0., 0., 0. };
+    G4double rmsZ = 0.;
+    G4double rmsR = 0.;
+    if (fShowerE > 0.) {
+      cog[0] = fShowerEX/fShowerE;
+      cog[1] = fShowerEY/fShowerE;
+      cog[2] = fShowerEZ/fShowerE;
+      rmsZ = std::sqrt(std::max(0., fShowerEZ2/fShowerE - cog[2]*cog[2]));
+      rmsR = std::sqrt(std::max(0., fShowerEX2/fShowerE - cog[0]*cog[0] +
+                                    fShowerEY2/fShowerE - cog[1]*cog[1]));
+    }
+    fRecord.AddRow(B4RunAction::kShowerNtuple, eventID, fShowerE,
+                   cog[0], cog[1], cog[2], rmsZ, rmsR, nofHits);
+    fRecord.AppendToRow(B4RunAction::kShowerNtuple, fShowerEnergybyLyr, 48);
+  }
+
+  // shower shape histograms (thread local, merged at the end of run)
+  if (fCollectShape) {
+    auto radiusBinWidth = fRunAction->GetRadiusMax()/fEnergybyRadius.size();
+    auto cogX = ( fShowerE > 0. ) ? fShowerEX/fShowerE : 0.;
+    auto cogY = ( fShowerE > 0. ) ? fShowerEY/fShowerE : 0.;
+    for (auto tile : fFiredTiles) {
+      auto x = fTileX0 + ((tile/100)%100)*fTileSize - cogX;
+      auto y = fTileY0 + (tile%100)*fTileSize - cogY;
+      auto bin = static_cast<std::size_t>(std::sqrt(x*x + y*y)/radiusBinWidth);
+      if (bin < fEnergybyRadius.size()) fEnergybyRadius[bin] += energyGap[tile];
+    }
+    for (G4int l = 0; l < 48; l++) {
+      analysisManager->FillH2(0, l + 0.5, fShowerEnergybyLyr[l]);
+      analysisManager->FillP1(0, l + 0.5, fShowerEnergybyLyr[l]);
+    }
+    for (std::size_t bin = 0; bin < fEnergybyRadius.size(); bin++) {
+      auto radius = (bin + 0.5)*radiusBinWidth;
+      analysisManager->FillH2(1, radius, fEnergybyRadius[bin]);
+      analysisManager->FillP1(1, radius, fEnergybyRadius[bin]);
     }
-    for (G4int ix = 0; ix < nofModuleX*9; ix++) {
-      for (G4int iy = 0; iy < nofModuleY*9; iy++) {
-        if (fEnergyGapbyLyr[l][ix][iy] != 0) {
-          analysisManager->FillNtupleDColumn(1, 0, eventID);
-          analysisManager->FillNtupleDColumn(1, 1, l);
-          analysisManager->FillNtupleDColumn(1, 2, ix);
-          analysisManager->FillNtupleDColumn(1, 3, iy);
-          analysisManager->FillNtupleDColumn(1, 4, 1);
-          analysisManager->FillNtupleDColumn(1, 5, fEnergyGapbyLyr[l][ix][iy]);
-          analysisManager->AddNtupleRow(1);
-        }
+    for (std::size_t bin = 0; bin < fEnergybyTime.size(); bin++) {
+      auto time = (bin + 0.5)*fShapeTimeBinWidth;
+      analysisManager->FillH2(2, time, fEnergybyTime[bin]);
+      analysisManager->FillP1(2, time, fEnergybyTime[bin]);
+    }
+  }
+
+  // fill ntuple2 (the fired tiles sorted by layer, xtile and ytile)
+  if (fRunAction->IsNtupleActive(B4RunAction::kEdepNtuple)) {
+    auto tile = fFiredTiles.begin();
+    for (G4int l = 0; l < 48; l++) {
+      if (fEnergyAbsbyLyr[l] != 0) {
+        fRecord.AddRow(B4RunAction::kEdepNtuple, eventID, l, 0, 0, 0, fEnergyAbsbyLyr[l], 0);
+      }
+      for (; tile != fFiredTiles.end() && *tile/10000 == l; ++tile) {
+        if (energyGap[*tile] < fTileThreshold) continue;
+        fRecord.AddRow(B4RunAction::kEdepNtuple, eventID, l, (*tile/100)%100, *tile%100, 1,
+                       energyGap[*tile], ( fTimeWindow > 0. ) ? fEnergyGapOut[*tile] : 0.);
+      }
+    }
+  }
+
+  // digitize the fired tiles and keep the tiles above threshold
+  if (fDigitize) {
+    fFiredVisible.resize(fFiredTiles.size());
+    for (std::size_t i = 0; i < fFiredTiles.size(); ++i) {
+      fFiredVisible[i] = fVisibleGap[fFiredTiles[i]];
+    }
+    fDigitizer->Digitize(fFiredVisible, fAmplitude);
+    for (std::size_t i = 0; i < fFiredTiles.size(); ++i) {
+      if (fAmplitude[i] > 0.) {
+        auto tile = fFiredTiles[i];
+        fRecord.AddRow(B4RunAction::kDigiNtuple, eventID, tile/10000,
+                       (tile/100)%100, tile%100, fAmplitude[i]);
       }
     }
   }
 
-  //fill ntuple3
-  for (std::vector<double>::iterator i = fDetectTime.begin(); i != fDetectTime.end(); i++) {
-    int read = std::distance(fDetectTime.begin(), i);
-    analysisManager->FillNtupleDColumn(2, 0, eventID);
-    analysisManager->FillNtupleDColumn(2, 1, fDetectLayer[read]);
-    analysisManager->FillNtupleDColumn(2, 2, fDetectTileX[read]);
-    analysisManager->FillNtupleDColumn(2, 3, fDetectTileY[read]);
-    analysisManager->FillNtupleDColumn(2, 4, fDetectEnergy[read]);
-    analysisManager->FillNtupleDColumn(2, 5, fDetectTime[read]);
-    analysisManager->FillNtupleDColumn(2, 6, fDetectPartileID[read]);
-    analysisManager->AddNtupleRow(2);
-    // G4cout << "Save {Event:" << eventID << ", GorA:" << fDetectGorA[read] << ", Layer:" << fDetectLayer[read] << ", X:" << ix <<
-    //   ", Y:" << iy << ", Edep:" << fDetectEnergy[read] << ", Time:" << fDetectTime[read] << "}" << G4endl;
-  }
-
-  if (fIncidentPointX.empty()) {
-    analysisManager->FillNtupleDColumn(3, 0, eventID);
-    analysisManager->FillNtupleDColumn(3, 1, fGenerationPointX);
-    analysisManager->FillNtupleDColumn(3, 2, fGenerationPointY);
-    analysisManager->FillNtupleDColumn(3, 3, fGenerationPointZ);
-    analysisManager->FillNtupleDColumn(3, 4, fInitialEnergy);
-    analysisManager->FillNtupleDColumn(3, 5, fMomentumX);
-    analysisManager->FillNtupleDColumn(3, 6, fMomentumY);
-    analysisManager->FillNtupleDColumn(3, 7, fMomentumZ);
-    analysisManager->FillNtupleDColumn(3, 8, 0);
-    analysisManager->FillNtupleDColumn(3, 9, 0);
-    analysisManager->FillNtupleDColumn(3, 10, fVertexX);
-    analysisManager->FillNtupleDColumn(3, 11, fVertexY);
-    analysisManager->FillNtupleDColumn(3, 12, fVertexZ);
-    analysisManager->FillNtupleDColumn(3, 13, -fParticleNumber);
-    analysisManager->FillNtupleDColumn(3, 14, 0);
-    analysisManager->AddNtupleRow(3);
-  } else {
-    for (std::vector<double>::iterator i = fIncidentPointX.begin(); i != fIncidentPointX.end(); i++) {
-      int read = std::distance(fIncidentPointX.begin(), i);
-      analysisManager->FillNtupleDColumn(3, 0, eventID);
-      analysisManager->FillNtupleDColumn(3, 1, fGenerationPointX);
-      analysisManager->FillNtupleDColumn(3, 2, fGenerationPointY);
-      analysisManager->FillNtupleDColumn(3, 3, fGenerationPointZ);
-      analysisManager->FillNtupleDColumn(3, 4, fInitialEnergy);
-      analysisManager->FillNtupleDColumn(3, 5, fMomentumX);
-      analysisManager->FillNtupleDColumn(3, 6, fMomentumY);
-      analysisManager->FillNtupleDColumn(3, 7, fMomentumZ);
-      analysisManager->FillNtupleDColumn(3, 8, fIncidentPointX[read]);
-      analysisManager->FillNtupleDColumn(3, 9, fIncidentPointY[read]);
-      analysisManager->FillNtupleDColumn(3, 10, fVertexX);
-      analysisManager->FillNtupleDColumn(3, 11, fVertexY);
-      analysisManager->FillNtupleDColumn(3, 12, fVertexZ);
-      analysisManager->FillNtupleDColumn(3, 13, fParticleNumber);
-      analysisManager->FillNtupleDColumn(3, 14, fIncidentID[read]);
-      analysisManager->AddNtupleRow(3);
-      fParticleNumber++;
+  //fill ntuple3 (the merged hits hold the energy weighted time sum)
+  for (std::size_t read = 0; read < fDetectTime.size(); read++) {
+    if (fTileThreshold > 0.) {
+      auto tile = (fDetectLayer[read]*100 + fDetectTileX[read])*100 + fDetectTileY[read];
+      if (energyGap[tile] < fTileThreshold) continue;
     }
+    auto time = fDetectTime[read];
+    if (fTimeBinWidth > 0.) time /= fDetectEnergy[read];
+    fRecord.AddRow(B4RunAction::kGapEdepNtuple,
+                   eventID, fDetectLayer[read], fDetectTileX[read], fDetectTileY[read],
+                   fDetectEnergy[read], time, fDetectPartileID[read],
+                   fDetectNofSteps[read]);
   }
+
+  if (fRunAction->IsNtupleActive(B4RunAction::kConditionNtuple)) {
+    if (fIncidentPointX.empty()) {
+      fRecord.AddRow(B4RunAction::kConditionNtuple, eventID,
+                     fGenerationPointX, fGenerationPointY, fGenerationPointZ,
+                     fInitialEnergy, fMomentumX, fMomentumY, fMomentumZ,
+                     0, 0, fVertexX, fVertexY, fVertexZ, -fParticleNumber, 0,
+                     fStartProcess, fStartLayer, fStartPointX, fStartPointY, fStartPointZ,
+                     0, 0, 0, 0, 0, fRunAction->GetRunSeed(),
+                     fRunAction->GetRunID());
+    } else {
+      for (std::size_t read = 0; read < fIncidentPointX.size(); read++) {
+        fRecord.AddRow(B4RunAction::kConditionNtuple, eventID,
+                       fGenerationPointX, fGenerationPointY, fGenerationPointZ,
+                       fInitialEnergy, fMomentumX, fMomentumY, fMomentumZ,
+                       fIncidentPointX[read], fIncidentPointY[read],
+                       fVertexX, fVertexY, fVertexZ, fParticleNumber, fIncidentID[read],
+                       fStartProcess, fStartLayer, fStartPointX, fStartPointY, fStartPointZ,
+                       fIncidentPointZ[read], fIncidentMomentumX[read],
+                       fIncidentMomentumY[read], fIncidentMomentumZ[read],
+                       fIncidentEnergy[read], fRunAction->GetRunSeed(),
+                       fRunAction->GetRunID());
+        fParticleNumber++;
+      }
+    }
+  }
+
+  // high-water capacity of the per-event buffers, before the record
+  // is swapped in the reorder buffer
+  if ( fMemoryMonitor->IsEnabled() ) {
+    fMemoryMonitor->SetBufferBytes(B4MemoryMonitor::kGapEdepHits,
+      CapacityBytes(fDetectLayer) + CapacityBytes(fDetectTileX)
+      + CapacityBytes(fDetectTileY) + CapacityBytes(fDetectTime)
+      + CapacityBytes(fDetectEnergy) + CapacityBytes(fDetectPartileID)
+      + CapacityBytes(fDetectNofSteps));
+    // the nodes are estimated as the entry and two pointers
+    fMemoryMonitor->SetBufferBytes(B4MemoryMonitor::kHitIndex,
+      fHitIndex.bucket_count()*sizeof(void*)
+      + fHitIndex.size()*(sizeof(HitKey) + sizeof(std::size_t)
+                          + 2*sizeof(void*)));
+    fMemoryMonitor->SetBufferBytes(B4MemoryMonitor::kIncidents,
+      CapacityBytes(fIncidentPointX) + CapacityBytes(fIncidentPointY)
+      + CapacityBytes(fIncidentPointZ) + CapacityBytes(fIncidentMomentumX)
+      + CapacityBytes(fIncidentMomentumY) + CapacityBytes(fIncidentMomentumZ)
+      + CapacityBytes(fIncidentEnergy) + CapacityBytes(fIncidentID));
+    fMemoryMonitor->SetBufferBytes(B4MemoryMonitor::kFiredTiles,
+      CapacityBytes(fFiredTiles));
+    fMemoryMonitor->SetBufferBytes(B4MemoryMonitor::kDigitization,
+      CapacityBytes(fVisibleGap) + CapacityBytes(fFiredVisible)
+      + CapacityBytes(fAmplitude));
+    fMemoryMonitor->SetBufferBytes(B4MemoryMonitor::kTimeWindow,
+      CapacityBytes(fEnergyGapOut));
+    fMemoryMonitor->SetBufferBytes(B4MemoryMonitor::kEventRecord,
+      fRecord.GetNofBytes());
+  }
+
+  // write the rows (directly or through the reorder buffer)
+  fRunAction->FillEvent(fRecord);
+
+  // time and steps of this thread in the event, for the idle time
+  // and the steps/s of the run
+  std::chrono::duration<G4double> eventTime
+    = std::chrono::steady_clock::now() - fEventStart;
+  fRunAction->GetRunTimer()->AddEventTime(eventTime.count()*s, fNofSteps);
   
   // Print per event (modulo n)
   //
@@ -231,6 +486,63 @@ void B4aEventAction::EndOfEventAction(const G4Event* event)
                                         << G4BestUnit(fTrackLGap,"Length")
        << G4endl;
   }
+
+  if ( fMemoryMonitor->IsEnabled() ) fMemoryMonitor->EndEvent();
 }  
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4aEventAction::DefineCommands()
+{
+  fMessenger
+    = new G4GenericMessenger(this, "/B4/event/", "Event collection control");
+
+  auto& timeBinCmd
+    = fMessenger->DeclarePropertyWithUnit("timeBin", "ns", fTimeBinWidth,
+        "Merge the Gap_Edep entries of the same layer, tile, particle and "
+        "time bin of this width (0 = one entry per step).");
+  timeBinCmd.SetParameterName("width", false);
+  timeBinCmd.SetRange("width>=0.");
+  timeBinCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& thresholdCmd
+    = fMessenger->DeclarePropertyWithUnit("threshold", "MeV", fThreshold,
+        "Do not write the tiles with an energy below this threshold "
+        "in Edep and Gap_Edep (0 = all tiles).");
+  thresholdCmd.SetParameterName("threshold", false);
+  thresholdCmd.SetRange("threshold>=0.");
+  thresholdCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& thresholdMipCmd
+    = fMessenger->DeclareProperty("thresholdMip", fThresholdMip,
+        "Set the tile threshold in MIP (overrides /B4/event/threshold; "
+        "0 = not used).");
+  thresholdMipCmd.SetParameterName("threshold", false);
+  thresholdMipCmd.SetRange("threshold>=0.");
+  thresholdMipCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& windowCmd
+    = fMessenger->DeclarePropertyWithUnit("timeWindow", "ns", fTimeWindow,
+        "Integrate the tile energies in a readout window of this width "
+        "(0 = no window).");
+  windowCmd.SetParameterName("width", false);
+  windowCmd.SetRange("width>=0.");
+  windowCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& windowStartCmd
+    = fMessenger->DeclarePropertyWithUnit("timeWindowStart", "ns",
+        fTimeWindowStart,
+        "Set the start of the readout window relative to the arrival "
+        "of the first particle at the calorimeter.");
+  windowStartCmd.SetParameterName("start", false);
+  windowStartCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& dropCmd
+    = fMessenger->DeclareProperty("dropOutOfWindow", fDropOutOfWindow,
+        "Do not write the Gap_Edep entries outside the readout window.");
+  dropCmd.SetParameterName("drop", true);
+  dropCmd.SetDefaultValue("true");
+  dropCmd.SetStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -30,127 +30,201 @@
 #include "B4aSteppingAction.hh"
 #include "B4aEventAction.hh"
 #include "B4DetectorConstruction.hh"
+#include "B4StepProfiler.hh"
+#include "B4StepStream.hh"
 
 #include "G4Step.hh"
+#include "G4GenericMessenger.hh"
+#include "G4LogicalVolume.hh"
 #include "G4RunManager.hh"
+#include "G4VProcess.hh"
+#include "G4HadronicProcessType.hh"
+#include "G4SystemOfUnits.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 B4aSteppingAction::B4aSteppingAction(
                       const B4DetectorConstruction* detectorConstruction,
-                      B4aEventAction* eventAction)
+                      B4aEventAction* eventAction,
+                      B4StepProfiler* stepProfiler,
+                      B4StepStreamWriter* stepStream)
   : G4UserSteppingAction(),
     fDetConstruction(detectorConstruction),
-    fEventAction(eventAction)
-{}
+    fEventAction(eventAction),
+    fStepProfiler(stepProfiler),
+    fStepStream(stepStream),
+    fMessenger(nullptr),
+    fVerboseLevel(0)
+{
+  DefineCommands();
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 B4aSteppingAction::~B4aSteppingAction()
-{}
+{
+  delete fMessenger;
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void B4aSteppingAction::UserSteppingAction(const G4Step* step)
 {
-// Collect energy and track length step by step
-  WorldEdgeZ = fDetConstruction->fWorldEdgeZ;
-  ECalorEdgeZ = fDetConstruction->fECalorEdgeZ;
-  HCalorEdgeZ = fDetConstruction->fHCalorEdgeZ;
-  G4int nofModuleX = fDetConstruction->fNModuleX;
-  G4int nofModuleY = fDetConstruction->fNModuleY;
+  if ( fStepProfiler->IsEnabled() ) fStepProfiler->Record(step);
 
+  // the full record is filled only for the step stream, otherwise only
+  // the fields used by ProcessStep() for this step
+  auto capturing = fStepStream->IsCapturing();
 
   //get Track
   auto track = step->GetTrack();
+  auto touchable = step->GetPreStepPoint()->GetTouchableHandle();
+  auto postStepPoint = step->GetPostStepPoint();
+
+  // get volume class of the current step; the gap tiles are separate
+  // placements of the same logical volume
+  auto volume = touchable->GetVolume()->GetLogicalVolume();
+  fRecord.fVolume = B4StepRecord::kOther;
+  if ( volume == fDetConstruction->GetHAbsorberPV()->GetLogicalVolume() ) {
+    fRecord.fVolume = B4StepRecord::kAbsorber;
+  }
+  else if ( volume == fDetConstruction->GetHGapPV()->GetLogicalVolume() ) {
+    fRecord.fVolume = B4StepRecord::kGap;
+  }
 
-  // get volume of the current step
-  auto volume = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume();
-  
-  // energy deposit
-  auto edep = step->GetTotalEnergyDeposit();
+  // get layer number (replica number) and tile number (copy number)
+  fRecord.fReplicaNo = ( fRecord.fVolume != B4StepRecord::kOther )
+                     ? touchable->GetReplicaNumber(1) : -1;
+  fRecord.fCopyNo = ( fRecord.fVolume == B4StepRecord::kGap )
+                  ? touchable->GetCopyNumber(0) : -1;
+
+  // get particle, track and parent ID
+  fRecord.fParticle = track->GetDynamicParticle()->GetPDGcode();
+  fRecord.fTrackID = track->GetTrackID();
+  fRecord.fParentID = track->GetParentID();
+
+  // the step leaves the world volume through the AHCAL boundary;
+  // the process defining the step is a hadronic inelastic interaction
+  // (needed only for the shower start of the primary)
+  fRecord.fFlags = 0;
+  if ( track->GetDefinition()->GetPDGCharge() != 0. ) {
+    fRecord.fFlags |= B4StepRecord::kCharged;
+  }
+  if ( postStepPoint->GetStepStatus() == fGeomBoundary &&
+       touchable->GetHistoryDepth() == 0 ) {
+    fRecord.fFlags |= B4StepRecord::kIncident;
+  }
+  if ( capturing ||
+       ( fRecord.fTrackID == 1 && ! fEventAction->HasShowerStart() ) ) {
+    auto process = postStepPoint->GetProcessDefinedStep();
+    if ( process && process->GetProcessSubType() == fHadronInelastic ) {
+      fRecord.fFlags |= B4StepRecord::kHadronInelastic;
+    }
+  }
+
+  // energy deposit, step length and detect time (Global Time)
+  fRecord.fEdep = step->GetTotalEnergyDeposit();
+  fRecord.fStepLength = step->GetStepLength();
+  fRecord.fTime = track->GetGlobalTime();
+
+  // positions and the momentum after the step, for the incident points
+  // and the shower start
+  if ( capturing || ( fRecord.fFlags & ( B4StepRecord::kIncident
+                                       | B4StepRecord::kHadronInelastic ) ) ) {
+    fRecord.fPostPosition = postStepPoint->GetPosition();
+  }
+  if ( capturing || ( fRecord.fFlags & B4StepRecord::kIncident ) ) {
+    fRecord.fPostMomentum = postStepPoint->GetMomentum();
+    fRecord.fPostEnergy = postStepPoint->GetKineticEnergy();
+  }
+  if ( capturing ) {
+    fRecord.fPrePosition = step->GetPreStepPoint()->GetPosition();
+  }
+
+  ProcessStep(fRecord, step);
 
-  // get detect time(Global Time)
-  auto time = track->GetGlobalTime();
+  if ( capturing ) fStepStream->AddStep(fRecord);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-  // get particle ID
-  G4int particleID = track->GetDynamicParticle()->GetPDGcode();
+void B4aSteppingAction::ProcessStep(const B4StepRecord& record,
+                                    const G4Step* step)
+{
+// Collect energy and track length step by step
+  fEventAction->CountStep();
 
-  // get track ID
-  G4int trackID = track->GetTrackID();
+  G4int nofModuleY = fDetConstruction->fNModuleY;
 
-  // get parent ID
-  G4int parentID = track->GetParentID();
+  auto edep = record.fEdep;
+  auto time = record.fTime;
+  G4int particleID = record.fParticle;
+  G4int trackID = record.fTrackID;
+  G4int parentID = record.fParentID;
   
-  // step length
+  // step length of charged particles
   G4double stepLength = 0.;
-  if ( track->GetDefinition()->GetPDGCharge() != 0. ) {
-    stepLength = step->GetStepLength();
+  if ( record.fFlags & B4StepRecord::kCharged ) {
+    stepLength = record.fStepLength;
   }
 
   // get Habsorber id
-  if ( volume->GetName() == fDetConstruction->GetHAbsorberPV()->GetName() ) {
-    G4int lyrid = step->GetPreStepPoint()->GetTouchableHandle()->GetReplicaNumber(1);//get layer number (replica Number)
+  if ( record.fVolume == B4StepRecord::kAbsorber ) {
+    G4int lyrid = record.fReplicaNo;
     fEventAction->AddAbs(edep, stepLength, lyrid);
   }
 
   // get Hgap id
-  if ( volume->GetName() == fDetConstruction->GetHGapPV()->GetName() ) {
-    G4int lyrid = step->GetPreStepPoint()->GetTouchableHandle()->GetReplicaNumber(1);//get layer number (replica Number)
-    G4int copy = step->GetPreStepPoint()->GetTouchableHandle()->GetCopyNumber(0);
+  if ( record.fVolume == B4StepRecord::kGap ) {
+    G4int lyrid = record.fReplicaNo;
+    G4int copy = record.fCopyNo;
     G4int tilex = static_cast<int>(copy/(9*nofModuleY));
     G4int tiley = static_cast<int>(copy%(9*nofModuleY));
-    fEventAction->AddGap(edep, stepLength, lyrid, tilex, tiley);
+    fEventAction->AddGap(edep, stepLength, time, lyrid, tilex, tiley);
     if ( edep > 0 ) {
       fEventAction->AddTime(edep, time, particleID, lyrid, tilex, tiley);
     }
   }
 
-  // get PreStepPoint
-  auto prepoint = step->GetPreStepPoint()->GetPosition();
-
-  // get PrePostPoint
-  auto postpoint = step->GetPostStepPoint()->GetPosition();
-
-  // get TrackID=1 infomation
-  
-  // get event condition
-  if ( fEventAction->EventInitialInfo == 0 && trackID == 1) {
-    auto vertex = track->GetVertexPosition();
-    auto energy = track->GetDynamicParticle()->GetKineticEnergy();
-    auto momentum = track->GetMomentum();
-    G4double vertexx = vertex.x();
-    G4double vertexy = vertex.y();
-    G4double vertexz = vertex.z();
-    G4double momentumx = momentum.x();
-    G4double momentumy = momentum.y();
-    G4double momentumz = momentum.z();
-    G4cout << "--Initial Condition" << G4endl;
-    G4cout << "Initial Point:{" << vertexx << " , " << vertexy << " , " << vertexz << "}" << G4endl;
-    G4cout << "Initial Energy:" << energy << G4endl;
-    G4cout << "Initial Momentum:{" << momentumx << " , " << momentumy << " , " << momentumz << "}" << G4endl;
-    fEventAction->AddCondition(vertexx, vertexy, vertexz, energy, momentumx, momentumy, momentumz);
-  }
-
   // get incident point in AHCAL
-  if ( prepoint.z() == HCalorEdgeZ && ( trackID == 1 || parentID == 1) ) {
-    G4double prepointx = prepoint.x();
-    G4double prepointy = prepoint.y();
-    G4cout << "--Incident to Calorimeter" << G4endl;
-    G4cout << "ParticleName:" << track->GetDynamicParticle()->GetParticleDefinition()->GetParticleName() << G4endl;
-    G4cout << "ParticleID:" << particleID << G4endl;
-    G4cout << "TrackID:" << trackID << G4endl;
-    G4cout << "ParentID:" << parentID << G4endl;
-    G4cout << "Particle Incident:{" << prepointx << " , " << prepointy << " , " << prepoint.z() << "}" << G4endl;
-    fEventAction->AddIncident(prepointx, prepointy, particleID);
+  // (the step leaves the world volume through the AHCAL boundary)
+  if ( record.fFlags & B4StepRecord::kIncident ) {
+    auto incpoint = record.fPostPosition;
+    auto incmomentum = record.fPostMomentum;
+    auto incenergy = record.fPostEnergy;
+    if ( fVerboseLevel > 0 ) {
+      G4cout << "--Incident to Calorimeter" << G4endl;
+      if ( step ) {
+        G4cout << "ParticleName:" << step->GetTrack()->GetDynamicParticle()->GetParticleDefinition()->GetParticleName() << G4endl;
+      }
+      G4cout << "ParticleID:" << particleID << G4endl;
+      G4cout << "TrackID:" << trackID << G4endl;
+      G4cout << "ParentID:" << parentID << G4endl;
+      G4cout << "Particle Incident:{" << incpoint.x() << " , " << incpoint.y() << " , " << incpoint.z() << "}" << G4endl;
+    }
+    fEventAction->AddIncident(incpoint.x(), incpoint.y(), incpoint.z(),
+                              incmomentum.x(), incmomentum.y(), incmomentum.z(),
+                              incenergy, particleID, time);
   }
 
-  // get ID=1 particle decay point
-  if ( trackID == 1 ) {
-    G4double postpointx = postpoint.x();
-    G4double postpointy = postpoint.y();
-    G4double postpointz = postpoint.z();
-    fEventAction->AddVertex(postpointx, postpointy, postpointz, time);
+  // get first hadronic inelastic interaction of ID=1 particle
+  if ( trackID == 1 && ! fEventAction->HasShowerStart() &&
+       ( record.fFlags & B4StepRecord::kHadronInelastic ) ) {
+    G4int lyrid = -1;
+    if ( record.fVolume != B4StepRecord::kOther ) {
+      lyrid = record.fReplicaNo;
+    }
+    auto startpoint = record.fPostPosition;
+    if ( fVerboseLevel > 0 ) {
+      G4cout << "--Shower Start" << G4endl;
+      if ( step ) {
+        G4cout << "ProcessName:" << step->GetPostStepPoint()->GetProcessDefinedStep()->GetProcessName() << G4endl;
+      }
+      G4cout << "Layer:" << lyrid << G4endl;
+      G4cout << "Start Point:{" << startpoint.x() << " , " << startpoint.y() << " , " << startpoint.z() << "}" << G4endl;
+    }
+    fEventAction->AddShowerStart(fHadronInelastic, lyrid,
+                                 startpoint.x(), startpoint.y(), startpoint.z());
   }
 
   // // get ParentID=1
@@ -163,3 +237,19 @@ void B4aSteppingAction::UserSteppingAction(const G4Step* step)
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void B4aSteppingAction::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/step/", "Stepping action control");
+
+  auto& verboseCmd
+    = fMessenger->DeclareProperty("verbose", fVerboseLevel,
+        "Print the initial condition, the incident particles and the shower "
+        "start (1); their values are written in the Event_Condition ntuple.");
+  verboseCmd.SetParameterName("level", true);
+  verboseCmd.SetDefaultValue("1");
+  verboseCmd.SetRange("level>=0");
+  verboseCmd.SetStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -3,7 +3,5 @@ do
     energy=`expr $i \* 2`
     echo "./pi_macro/pi_${energy}GeV.mac"
     ./exampleB4a -m "./pi_macro/pi_${energy}GeV.mac"
-    mv "B4.root" "pi.root"
-    mv "pi.root" "../CNN/test_dataset/data_${energy}GeV"
     python ../messege.py "geant4_${energy}GeV_finish"
 done
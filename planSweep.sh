@@ -0,0 +1,70 @@
+# Plan an energy sweep of B4a_stable over several jobs which finish at the
+# same time, with the event cost model fitted at the end of previous runs
+# (the .cost files next to their output files, from B4a_random or from
+# several energies of B4a_stable).
+#   ./planSweep.sh <number of jobs> <events per energy> "<energies in GeV>" <cost files>
+# e.g.
+#   ./planSweep.sh 8 10000 "`seq -s ' ' 2 2 30`" ../CNN/test_dataset/*/*.cost
+# writes sweep/job<N>.mac; each job is run in the build directory of
+# B4a_stable as ./exampleB4a -m sweep/job<N>.mac
+# The run ID of the seeds of each energy is its index in the sweep (from 0),
+# whichever job simulates it, so an event is replayed with
+# /B4/random/replayRun <RunID> and replayEvent <Enumber>.
+jobs=$1
+events=$2
+energies=$3
+shift 3
+mkdir -p sweep
+
+grep -h -v "^#" "$@" | awk -v jobs=${jobs} -v nofEvents=${events} -v energies="${energies}" '
+{ n += $1; sE += $2; sE2 += $3; sT += $4; sET += $5 }
+END {
+  if ( n < 1 ) { print "no events in the cost files"; exit 1 }
+  # cost = a + b*E, proportional to E if the runs had a single energy
+  a = 0; b = sT/sE
+  d = n*sE2 - sE*sE
+  if ( d > 1e-6*n*sE2 ) { b = (n*sET - sE*sT)/d; a = (sT - b*sE)/n }
+  printf "cost model: %g s + %g s/GeV * E (%d events)\n", a, b, n
+
+  nofEnergies = split(energies, energy, " ")
+  total = 0
+  for (i = 1; i <= nofEnergies; ++i) {
+    cost[i] = a + b*energy[i]
+    if ( cost[i] <= 0 ) cost[i] = 1e-9
+    total += nofEvents*cost[i]
+  }
+  target = total/jobs
+
+  # fill the jobs in turn up to the target time, an energy is split between
+  # two jobs with consecutive event numbers (and so disjoint seeds) and the
+  # same run ID, so that its events do not depend on the split
+  job = 0; load = 0
+  for (i = 1; i <= nofEnergies; ++i) {
+    first = 0
+    while ( first < nofEvents ) {
+      n = nofEvents - first
+      if ( job < jobs - 1 ) {
+        m = int((target - load)/cost[i] + 0.5)
+        if ( m < n ) n = m
+      }
+      if ( n > 0 ) {
+        macro = sprintf("sweep/job%d.mac", job)
+        if ( load == 0 ) {
+          printf "/run/initialize\n/gun/particle pi-\n/run/printProgress 1000\n" > macro
+        }
+        printf "#\n/gun/energy %g GeV\n", energy[i] > macro
+        printf "/B4/output/directory ../CNN/test_dataset/data_%gGeV\n", energy[i] > macro
+        printf "/B4/output/fileName pi_%d\n", first > macro
+        printf "/B4/job/runID %d\n", i - 1 > macro
+        printf "/B4/job/eventOffset %d\n/run/beamOn %d\n", first, n > macro
+        load += n*cost[i]
+        first += n
+      }
+      if ( first < nofEvents ) {
+        printf "job %d: %.0f s\n", job, load
+        job++; load = 0
+      }
+    }
+  }
+  printf "job %d: %.0f s\n", job, load
+}'